@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "disassembler.h"
+#include "text_scan.h"
+
+
+static std::vector<uint32_t> make_encodings(uint32_t opcode, size_t count) {
+    std::mt19937 rng(5);
+    std::vector<uint32_t> encodings;
+    while (encodings.size() < count) {
+        uint32_t raw = (rng() & ~0x7fu) | opcode;
+        if (decode_instruction(raw).mnemonic != Mnemonic::UNKNOWN) encodings.push_back(raw);
+    }
+    return encodings;
+}
+
+static void BM_get_bits(benchmark::State& state) {
+    std::vector<uint32_t> encodings = make_encodings(0b0110011, 4096);
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (uint32_t raw : encodings) sum += get_bits(raw, 12, 3) + get_bits(raw, 25, 7);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * encodings.size());
+}
+BENCHMARK(BM_get_bits);
+
+//// Аргумент - major opcode, по одному представителю на каждый формат R/I/S/B/U/J, плюс A и OP-FP.
+static void BM_decode_instruction(benchmark::State& state) {
+    std::vector<uint32_t> encodings = make_encodings(state.range(0), 4096);
+    for (auto _ : state) {
+        for (uint32_t raw : encodings) benchmark::DoNotOptimize(decode_instruction(raw));
+    }
+    state.SetItemsProcessed(state.iterations() * encodings.size());
+}
+BENCHMARK(BM_decode_instruction)
+        ->ArgName("opcode")
+        ->Arg(0b0110011)->Arg(0b0010011)->Arg(0b0100011)->Arg(0b1100011)->Arg(0b0110111)->Arg(0b1101111)
+        ->Arg(0b0101111)->Arg(0b1010011);
+
+//// Те же R команды через таблицы, собранные при запуске для --march=rv32imc, а не при компиляции.
+static void BM_decode_instruction_march(benchmark::State& state) {
+    std::vector<uint32_t> encodings = make_encodings(0b0110011, 4096);
+    set_extensions(extension_bit(Extension::M) | extension_bit(Extension::C));
+    for (auto _ : state) {
+        for (uint32_t raw : encodings) benchmark::DoNotOptimize(decode_instruction(raw));
+    }
+    set_extensions(ALL_EXTENSIONS);
+    state.SetItemsProcessed(state.iterations() * encodings.size());
+}
+BENCHMARK(BM_decode_instruction_march);
+
+static void BM_decode_compressed(benchmark::State& state) {
+    std::mt19937 rng(7);
+    std::vector<uint16_t> encodings;
+    while (encodings.size() < 4096) {
+        uint16_t raw = rng();
+        if ((raw & 0b11) != 0b11 && decode_compressed(raw).mnemonic != Mnemonic::UNKNOWN) encodings.push_back(raw);
+    }
+    for (auto _ : state) {
+        for (uint16_t raw : encodings) benchmark::DoNotOptimize(decode_compressed(raw));
+    }
+    state.SetItemsProcessed(state.iterations() * encodings.size());
+}
+BENCHMARK(BM_decode_compressed);
+
+static void BM_write_instruction(benchmark::State& state) {
+    std::vector<uint32_t> encodings = make_encodings(state.range(0), 4096);
+    std::vector<Instruction> insts;
+    for (uint32_t raw : encodings) insts.push_back(decode_instruction(raw));
+    Output_Buffer output;
+    for (auto _ : state) {
+        output.clear();
+        for (const Instruction& inst : insts) write_instruction(output, inst);
+        benchmark::DoNotOptimize(output.view().data());
+    }
+    state.SetItemsProcessed(state.iterations() * insts.size());
+}
+BENCHMARK(BM_write_instruction)
+        ->ArgName("opcode")
+        ->Arg(0b0110011)->Arg(0b0010011)->Arg(0b0100011)->Arg(0b1100011)->Arg(0b0110111)->Arg(0b1101111)
+        ->Arg(0b0101111)->Arg(0b1010011);
+
+//// Карта начал команд по 1 МБ случайного кода (примерно треть сжатых команд).
+//// Аргумент - Scan_Isa; неподдерживаемый процессором вариант пропускается.
+static void BM_scan_instruction_starts(benchmark::State& state) {
+    Scan_Isa isa = (Scan_Isa) state.range(0);
+    if (!scan_isa_supported(isa)) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    state.SetLabel(std::string(scan_isa_name(isa)));
+    std::mt19937 rng(5);
+    std::vector<uint8_t> text(1 << 20);
+    for (size_t i = 0; i < text.size(); i += 2) text[i] = rng() % 3 == 0 ? rng() & 0xfc : rng() | 0b11;
+    std::vector<uint64_t> starts(text.size() / 128);
+    for (auto _ : state) {
+        scan_instruction_starts(text.data(), text.size() / 2, true, starts.data(), isa);
+        benchmark::DoNotOptimize(starts.data());
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_scan_instruction_starts)
+        ->ArgName("isa")
+        ->Arg((int) Scan_Isa::SCALAR)->Arg((int) Scan_Isa::SSE2)->Arg((int) Scan_Isa::AVX2);
+
+//// То же, что делал split_text до карты: шаг по длине каждой команды.
+static void BM_scan_sequential(benchmark::State& state) {
+    std::mt19937 rng(5);
+    std::vector<uint8_t> text(1 << 20);
+    for (size_t i = 0; i < text.size(); i += 2) text[i] = rng() % 3 == 0 ? rng() & 0xfc : rng() | 0b11;
+    for (auto _ : state) {
+        size_t pos = 0, count = 0;
+        while (text.size() - pos >= 2) {
+            pos += (text[pos] & 0b11) == 0b11 ? 4 : 2;
+            count++;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_scan_sequential);
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include "disassembler.h"
+#include "elf_parser.h"
+
+
+static std::atomic<size_t> allocations{0};
+
+//// Заменяются все обычные формы new/delete, и все delete сводятся к одному: иначе часть памяти
+//// выделялась бы библиотечным new, а освобождалась через free (-Wmismatched-new-delete).
+//// malloc/free не встраиваются в вызывающий код: встроенную пару GCC принимает за чужую.
+#if defined(__GNUC__)
+#define ALLOCATOR __attribute__((noinline))
+#else
+#define ALLOCATOR
+#endif
+
+void* ALLOCATOR operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* ALLOCATOR operator new(size_t size, const std::nothrow_t&) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void ALLOCATOR operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+
+static std::vector<Instruction> make_instructions(size_t count) {
+    std::mt19937 rng(3);
+    std::vector<Instruction> insts;
+    insts.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        Instruction inst = decode_instruction(rng() | 3, i * BIG_INST_SIZE);
+        if (inst.mnemonic != Mnemonic::UNKNOWN) insts.push_back(inst);
+        else i--;
+    }
+    return insts;
+}
+
+static void BM_write_instruction_line(benchmark::State& state) {
+    std::vector<Instruction> insts = make_instructions(4096);
+    Output_Buffer output;
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        output.clear();
+        for (const Instruction& inst : insts) write_instruction_line(output, inst, ".LBB0_1");
+        benchmark::DoNotOptimize(output.view().data());
+    }
+    state.counters["allocs_per_inst"] = benchmark::Counter(
+            (double) (allocations.load() - before) / (state.iterations() * insts.size()));
+    state.SetItemsProcessed(state.iterations() * insts.size());
+}
+BENCHMARK(BM_write_instruction_line);
+
+static void BM_write_symtab_row(benchmark::State& state) {
+    const char strtab[] = "\0main";
+    Symbol_Table symbols;
+    symbols.values = {0x1040};
+    symbols.sizes = {124};
+    symbols.infos = {0x12};
+    symbols.others = {0};
+    symbols.indices = {2};
+    symbols.name_offsets = {1};
+    symbols.strtab = strtab;
+    symbols.strtab_size = sizeof(strtab);
+    Output_Buffer output;
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        output.clear();
+        for (size_t i = 0; i < 1024; i++) symbols.write(output, 0);
+        benchmark::DoNotOptimize(output.view().data());
+    }
+    state.counters["allocs_per_row"] = benchmark::Counter(
+            (double) (allocations.load() - before) / (state.iterations() * 1024));
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_write_symtab_row);
@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include "elf_parser.h"
+#include "synthetic_elf.h"
+
+namespace fs = std::filesystem;
+
+
+//// Поток, который ничего не пишет: меряем разбор и форматирование, а не диск.
+class Null_Buffer: public std::streambuf {
+protected:
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    int overflow(int c) override { return c; }
+};
+
+struct Pipeline_Fixture {
+    explicit Pipeline_Fixture(const std::string& filename):
+            image(filename),
+            header(image) {
+        header.search_sections_info(image, s_i_text, s_i_symtable, strtab);
+    }
+
+    Elf_Image image;
+    ELF_Header header;
+    Section_Info s_i_text, s_i_symtable, strtab;
+};
+
+static void BM_processing_symtable(benchmark::State& state, const std::string& filename) {
+    Pipeline_Fixture f(filename);
+    for (auto _ : state) {
+        RWer rw(&f.s_i_text, &f.s_i_symtable, &f.strtab, f.header.elf_class());
+        rw.processing_symtable(f.image);
+    }
+    state.SetBytesProcessed(state.iterations() * f.s_i_symtable.sh_size);
+}
+
+static void BM_processing_text(benchmark::State& state, const std::string& filename) {
+    Pipeline_Fixture f(filename);
+    RWer rw(&f.s_i_text, &f.s_i_symtable, &f.strtab, f.header.elf_class());
+    rw.processing_symtable(f.image);
+    Null_Buffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    std::unique_ptr<Thread_Pool> pool;
+    if (state.range(0) > 1) pool = std::make_unique<Thread_Pool>(state.range(0));
+    size_t instructions = 0;
+    for (auto _ : state) {
+        Output_Buffer output(&null_stream);
+        instructions += rw.processing_text(f.image, output, pool.get());
+    }
+    state.SetBytesProcessed(state.iterations() * f.s_i_text.sh_size);
+    state.SetItemsProcessed(instructions);
+}
+
+//// Повторный разбор того же файла: все функции уже в кэше, который заполняется до замера.
+static void BM_processing_text_cached(benchmark::State& state, const std::string& filename) {
+    Pipeline_Fixture f(filename);
+    RWer rw(&f.s_i_text, &f.s_i_symtable, &f.strtab, f.header.elf_class());
+    rw.processing_symtable(f.image);
+    Null_Buffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    fs::path directory = fs::temp_directory_path() / "lab_03_bench_cache";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    Listing_Cache cache(directory.string());
+    {
+        Output_Buffer output(&null_stream);
+        rw.processing_text(f.image, output, nullptr, &cache);
+    }
+    size_t instructions = 0;
+    for (auto _ : state) {
+        Output_Buffer output(&null_stream);
+        instructions += rw.processing_text(f.image, output, nullptr, &cache);
+    }
+    state.SetBytesProcessed(state.iterations() * f.s_i_text.sh_size);
+    state.SetItemsProcessed(instructions);
+    fs::remove_all(directory);
+}
+
+//// Размеры .text берутся из BENCH_TEXT_SIZES (например "1M,100M,1G"), файлы
+//// генерируются один раз во временном каталоге. Готовый файл можно задать через BENCH_ELF.
+static std::vector<std::pair<std::string, std::string>> bench_inputs() {
+    std::vector<std::pair<std::string, std::string>> inputs;
+    if (const char* elf = std::getenv("BENCH_ELF")) {
+        inputs.emplace_back(fs::path(elf).filename().string(), elf);
+        return inputs;
+    }
+    const char* env = std::getenv("BENCH_TEXT_SIZES");
+    std::stringstream sizes(env ? env : "1M");
+    std::string size;
+    while (std::getline(sizes, size, ',')) {
+        Synthetic_Elf_Params params;
+        params.text_size = parse_size(size);
+        fs::path path = fs::temp_directory_path() / ("lab_03_bench_" + size + ".elf");
+        if (!fs::exists(path)) write_synthetic_elf(path.string(), params);
+        inputs.emplace_back(size, path.string());
+    }
+    return inputs;
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    for (const auto& [name, filename] : bench_inputs()) {
+        benchmark::RegisterBenchmark(("BM_processing_symtable/" + name).c_str(), BM_processing_symtable, filename);
+        benchmark::RegisterBenchmark(("BM_processing_text/" + name).c_str(), BM_processing_text, filename)
+                ->ArgName("threads")->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_processing_text_cached/" + name).c_str(), BM_processing_text_cached,
+                                     filename)->UseRealTime()->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
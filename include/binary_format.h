@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "decoder.h"
+#include "elf_image.h"
+#include "label_index.h"
+#include "output_buffer.h"
+
+
+//// Двоичный листинг (--format=bin):
+////   Binary_Header | таблица строк с именами меток | Binary_Record * record_count
+//// Записи фиксированного размера, поэтому команда N читается по смещению за O(1),
+//// а файл можно отображать в память как массив.
+const char BINARY_MAGIC[8] = {'R', 'V', 'D', 'I', 'S', 'A', 'S', 'M'};
+const uint32_t BINARY_VERSION = 1;
+const uint32_t NO_LABEL = 0xffffffff;
+
+struct Binary_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t record_count;
+    uint64_t records_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t text_address;
+};
+
+struct Binary_Record {
+    uint64_t address;
+    uint32_t raw;
+    int32_t imm;
+    uint32_t label_offset;
+    uint16_t label_size;
+    uint16_t mnemonic;
+    uint8_t length;
+    uint8_t format;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    //// В версии 1 до fmadd/fmsub/fnmsub/fnmadd было зарезервировано (0).
+    uint8_t rs3;
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(Binary_Header) == 64, "Binary_Header layout");
+static_assert(sizeof(Binary_Record) == 32, "Binary_Record layout");
+
+//// Возвращает количество записанных команд.
+size_t write_binary_listing(std::ostream& output, const uint8_t* text, size_t size, uint64_t address,
+                            const Label_Index& labels, Xlen xlen = Xlen::RV32);
+
+class Binary_Listing {
+public:
+    explicit Binary_Listing(const std::string& filename);
+
+    size_t size() const;
+    Binary_Record record(size_t i) const;
+    Instruction instruction(size_t i) const;
+    std::string_view label(size_t i) const;
+
+    //// Восстанавливает текстовый листинг .text в том же виде, что и основной режим.
+    void write_text(Output_Buffer& output) const;
+
+private:
+    Elf_Image _file;
+    Binary_Header _header{};
+    const uint8_t* _records = nullptr;
+    std::string_view _strings;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "decoder.h"
+#include "label_index.h"
+#include "output_buffer.h"
+#include "thread_pool.h"
+
+
+//// Чем заканчивается базовый блок. FALLTHROUGH - следующий блок начинается с цели перехода
+//// (или кончилась функция), управление просто переходит дальше.
+enum class Block_End : uint8_t {
+    FALLTHROUGH, BRANCH, JUMP, INDIRECT, RETURN
+};
+
+enum class Edge_Kind : uint8_t {
+    FALLTHROUGH, TAKEN, JUMP
+};
+
+const uint32_t NO_BLOCK = UINT32_MAX;
+
+struct Cfg_Function {
+    uint64_t address;
+    uint32_t size;
+    uint32_t first_block;
+    uint32_t block_count;
+};
+
+struct Basic_Block {
+    uint64_t address;
+    uint32_t size;
+    uint32_t instructions;
+    uint32_t first_edge;
+    uint8_t edge_count;
+    Block_End end;
+};
+
+//// block - номер блока-цели или NO_BLOCK, если цель не начало команды ни одной функции.
+struct Cfg_Edge {
+    uint64_t target;
+    uint32_t block;
+    Edge_Kind kind;
+};
+
+//// Вызов (jal с rd != zero) из блока block; function - номер вызываемой функции или NO_BLOCK.
+struct Cfg_Call {
+    uint64_t target;
+    uint32_t block;
+    uint32_t function;
+};
+
+//// Граф потока управления одной секции. Только плоские массивы с индексами: блоки функции
+//// лежат подряд (first_block), рёбра блока тоже (first_edge), вызовы - по возрастанию блока.
+struct Control_Flow_Graph {
+    std::vector<Cfg_Function> functions;
+    std::vector<Basic_Block> blocks;
+    std::vector<Cfg_Edge> edges;
+    std::vector<Cfg_Call> calls;
+
+    //// Номер функции, начинающейся с address, или NO_BLOCK.
+    uint32_t function_at(uint64_t address) const;
+    //// Начала функций и цели переходов и вызовов внутри секции, по возрастанию, без повторов.
+    std::vector<uint64_t> targets() const;
+};
+
+//// Функции начинаются с entries (смещения FUNC из .symtab), с начала секции и с целей jal
+//// с rd != zero, найденных предварительным проходом. Каждая функция разбирается отдельно,
+//// с пулом - параллельно; время линейно по размеру секции.
+Control_Flow_Graph build_control_flow(const uint8_t* text, uint32_t size, uint64_t address, Xlen xlen,
+                                      std::vector<uint32_t> entries, Thread_Pool* pool = nullptr);
+
+//// Имя для адреса без символа: L_ и адрес в hex, не короче 8 цифр. buffer - не меньше 19 байт.
+std::string_view synthetic_label(uint64_t address, char* buffer);
+
+enum class Cfg_Format {
+    DOT, JSON
+};
+
+//// Граф в DOT выводится подграфами по функциям, в JSON - массивом функций с блоками.
+//// Несколько секций пишутся подряд между begin и end.
+void write_cfg_begin(Output_Buffer& output, Cfg_Format format);
+void write_cfg_section(Output_Buffer& output, Cfg_Format format, const Control_Flow_Graph& cfg,
+                       const Label_Index& labels, std::string_view section, uint32_t section_index, bool first);
+void write_cfg_end(Output_Buffer& output, Cfg_Format format);
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+
+#define DISASM_MNEMONICS(X) \
+    X(UNKNOWN, "unknown_command") \
+    X(LUI, "lui") X(AUIPC, "auipc") X(JAL, "jal") X(JALR, "jalr") \
+    X(BEQ, "beq") X(BNE, "bne") X(BLT, "blt") X(BGE, "bge") X(BLTU, "bltu") X(BGEU, "bgeu") \
+    X(LB, "lb") X(LH, "lh") X(LW, "lw") X(LD, "ld") X(LBU, "lbu") X(LHU, "lhu") X(LWU, "lwu") \
+    X(SB, "sb") X(SH, "sh") X(SW, "sw") X(SD, "sd") \
+    X(ADDI, "addi") X(SLTI, "slti") X(SLTIU, "sltiu") X(XORI, "xori") X(ORI, "ori") X(ANDI, "andi") \
+    X(SLLI, "slli") X(SRLI, "srli") X(SRAI, "srai") \
+    X(ADD, "add") X(SUB, "sub") X(SLL, "sll") X(SLT, "slt") X(SLTU, "sltu") \
+    X(XOR, "xor") X(SRL, "srl") X(SRA, "sra") X(OR, "or") X(AND, "and") \
+    X(ADDIW, "addiw") X(SLLIW, "slliw") X(SRLIW, "srliw") X(SRAIW, "sraiw") \
+    X(ADDW, "addw") X(SUBW, "subw") X(SLLW, "sllw") X(SRLW, "srlw") X(SRAW, "sraw") \
+    X(FENCE, "fence") X(FENCE_I, "fence.i") X(ECALL, "ecall") X(EBREAK, "ebreak") \
+    X(MUL, "mul") X(MULH, "mulh") X(MULHSU, "mulhsu") X(MULHU, "mulhu") \
+    X(DIV, "div") X(DIVU, "divu") X(REM, "rem") X(REMU, "remu") \
+    X(MULW, "mulw") X(DIVW, "divw") X(DIVUW, "divuw") X(REMW, "remw") X(REMUW, "remuw") \
+    X(LR_W, "lr.w") X(SC_W, "sc.w") X(AMOSWAP_W, "amoswap.w") X(AMOADD_W, "amoadd.w") \
+    X(AMOXOR_W, "amoxor.w") X(AMOAND_W, "amoand.w") X(AMOOR_W, "amoor.w") \
+    X(AMOMIN_W, "amomin.w") X(AMOMAX_W, "amomax.w") X(AMOMINU_W, "amominu.w") X(AMOMAXU_W, "amomaxu.w") \
+    X(LR_D, "lr.d") X(SC_D, "sc.d") X(AMOSWAP_D, "amoswap.d") X(AMOADD_D, "amoadd.d") \
+    X(AMOXOR_D, "amoxor.d") X(AMOAND_D, "amoand.d") X(AMOOR_D, "amoor.d") \
+    X(AMOMIN_D, "amomin.d") X(AMOMAX_D, "amomax.d") X(AMOMINU_D, "amominu.d") X(AMOMAXU_D, "amomaxu.d") \
+    X(FLW, "flw") X(FSW, "fsw") \
+    X(FMADD_S, "fmadd.s") X(FMSUB_S, "fmsub.s") X(FNMSUB_S, "fnmsub.s") X(FNMADD_S, "fnmadd.s") \
+    X(FADD_S, "fadd.s") X(FSUB_S, "fsub.s") X(FMUL_S, "fmul.s") X(FDIV_S, "fdiv.s") X(FSQRT_S, "fsqrt.s") \
+    X(FSGNJ_S, "fsgnj.s") X(FSGNJN_S, "fsgnjn.s") X(FSGNJX_S, "fsgnjx.s") X(FMIN_S, "fmin.s") X(FMAX_S, "fmax.s") \
+    X(FCVT_W_S, "fcvt.w.s") X(FCVT_WU_S, "fcvt.wu.s") X(FCVT_L_S, "fcvt.l.s") X(FCVT_LU_S, "fcvt.lu.s") \
+    X(FCVT_S_W, "fcvt.s.w") X(FCVT_S_WU, "fcvt.s.wu") X(FCVT_S_L, "fcvt.s.l") X(FCVT_S_LU, "fcvt.s.lu") \
+    X(FMV_X_W, "fmv.x.w") X(FMV_W_X, "fmv.w.x") X(FCLASS_S, "fclass.s") \
+    X(FEQ_S, "feq.s") X(FLT_S, "flt.s") X(FLE_S, "fle.s") \
+    X(FLD, "fld") X(FSD, "fsd") \
+    X(FMADD_D, "fmadd.d") X(FMSUB_D, "fmsub.d") X(FNMSUB_D, "fnmsub.d") X(FNMADD_D, "fnmadd.d") \
+    X(FADD_D, "fadd.d") X(FSUB_D, "fsub.d") X(FMUL_D, "fmul.d") X(FDIV_D, "fdiv.d") X(FSQRT_D, "fsqrt.d") \
+    X(FSGNJ_D, "fsgnj.d") X(FSGNJN_D, "fsgnjn.d") X(FSGNJX_D, "fsgnjx.d") X(FMIN_D, "fmin.d") X(FMAX_D, "fmax.d") \
+    X(FCVT_S_D, "fcvt.s.d") X(FCVT_D_S, "fcvt.d.s") \
+    X(FCVT_W_D, "fcvt.w.d") X(FCVT_WU_D, "fcvt.wu.d") X(FCVT_L_D, "fcvt.l.d") X(FCVT_LU_D, "fcvt.lu.d") \
+    X(FCVT_D_W, "fcvt.d.w") X(FCVT_D_WU, "fcvt.d.wu") X(FCVT_D_L, "fcvt.d.l") X(FCVT_D_LU, "fcvt.d.lu") \
+    X(FMV_X_D, "fmv.x.d") X(FMV_D_X, "fmv.d.x") X(FCLASS_D, "fclass.d") \
+    X(FEQ_D, "feq.d") X(FLT_D, "flt.d") X(FLE_D, "fle.d") \
+    X(CSRRW, "csrrw") X(CSRRS, "csrrs") X(CSRRC, "csrrc") X(CSRRWI, "csrrwi") X(CSRRSI, "csrrsi") X(CSRRCI, "csrrci") \
+    X(SH1ADD, "sh1add") X(SH2ADD, "sh2add") X(SH3ADD, "sh3add") X(ADD_UW, "add.uw") \
+    X(SH1ADD_UW, "sh1add.uw") X(SH2ADD_UW, "sh2add.uw") X(SH3ADD_UW, "sh3add.uw") X(SLLI_UW, "slli.uw") \
+    X(ANDN, "andn") X(ORN, "orn") X(XNOR, "xnor") X(CLZ, "clz") X(CTZ, "ctz") X(CPOP, "cpop") \
+    X(MAX, "max") X(MAXU, "maxu") X(MIN, "min") X(MINU, "minu") \
+    X(SEXT_B, "sext.b") X(SEXT_H, "sext.h") X(ZEXT_H, "zext.h") \
+    X(ROL, "rol") X(ROR, "ror") X(RORI, "rori") X(ORC_B, "orc.b") X(REV8, "rev8") \
+    X(CLZW, "clzw") X(CTZW, "ctzw") X(CPOPW, "cpopw") X(ROLW, "rolw") X(RORW, "rorw") X(RORIW, "roriw")
+
+enum class Mnemonic : uint16_t {
+#define DISASM_MNEMONIC_ID(id, name) id,
+    DISASM_MNEMONICS(DISASM_MNEMONIC_ID)
+#undef DISASM_MNEMONIC_ID
+    COUNT
+};
+
+//// Раскладка операндов при печати, а не формат кодирования из спецификации:
+//// NONE - без операндов, LOAD - "rd, imm(rs1)", SHIFT - imm хранит shamt.
+//// Дальше форматы расширений: UNARY - "rd, rs1"; CSR - "rd, csr, rs1" (imm - номер CSR),
+//// CSR_IMM - то же с uimm в rs1; LR - "rd, (rs1)", AMO - "rd, rs2, (rs1)" (aq/rl - суффикс
+//// из raw); F_LOAD/F_STORE - как LOAD/S с регистром f; у F_* буквы после F - классы
+//// операндов (F - регистр f, X - регистр x), _RM - режим округления из raw, если он не dyn.
+enum class Format : uint8_t {
+    NONE, R, I, LOAD, SHIFT, S, B, U, J,
+    UNARY, CSR, CSR_IMM, LR, AMO, F_LOAD, F_STORE,
+    F_FFF, F_FFF_RM, F_FFFF_RM, F_FF, F_FF_RM, F_XF, F_XF_RM, F_FX, F_FX_RM, F_XFF,
+    COUNT
+};
+
+//// Разрядность: в RV64 сдвиги берут 6-битный shamt, а часть сжатых команд другая
+//// (c.ld/c.sd/c.addiw/c.addw/c.subw вместо c.flw/c.fsw/c.jal).
+enum class Xlen : uint8_t {
+    RV32, RV64
+};
+
+struct Instruction {
+    uint64_t address;
+    uint32_t raw;
+    Mnemonic mnemonic;
+    Format format;
+    uint8_t length;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    //// Третий источник у fmadd/fmsub/fnmsub/fnmadd.
+    uint8_t rs3;
+    int32_t imm;
+};
+
+//// Расширения сверх базовых RV32I/RV64I. Команды выключенного расширения декодируются
+//// как unknown_command; по умолчанию включены все.
+enum class Extension : uint8_t {
+    M, A, F, D, C, ZICSR, ZBA, ZBB, COUNT
+};
+
+using Extension_Set = uint32_t;
+
+constexpr Extension_Set extension_bit(Extension extension) {
+    return 1u << (uint32_t) extension;
+}
+
+const Extension_Set ALL_EXTENSIONS = (1u << (uint32_t) Extension::COUNT) - 1;
+
+//// Переключает таблицы декодера. Вызывается до начала разбора: одновременно с декодированием
+//// в других потоках менять набор нельзя.
+void set_extensions(Extension_Set extensions);
+Extension_Set enabled_extensions();
+
+//// Набор из строки --march: rv32/rv64, i или g (= imafd_zicsr_zifencei), однобуквенные m, a, f,
+//// d, c, затем через '_' zicsr, zifencei, zba, zbb. F включает Zicsr, D требует F. Разрядность
+//// всё равно берётся из класса ELF. false - строка неверна.
+bool parse_march(std::string_view march, Extension_Set& extensions);
+
+std::string_view mnemonic_name(Mnemonic mnemonic);
+
+inline size_t instruction_length(uint16_t low_half) {
+    return (low_half & 0b11) == 0b11 ? 4 : 2;
+}
+
+Instruction decode_instruction(uint32_t raw, uint64_t address = 0, Xlen xlen = Xlen::RV32);
+
+//// Сжатые команды (RVC) разворачиваются в ту же запись, что и 32-битные, length == 2.
+Instruction decode_compressed(uint16_t raw, uint64_t address = 0, Xlen xlen = Xlen::RV32);
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "elf_parser.h"
+#include "output_buffer.h"
+#include "text_scan.h"
+
+
+const uint64_t DEFAULT_IMAGE_CACHE_SIZE = 1ull << 30;
+
+//// ELF образ, разобранный один раз для множества запросов сервера: заголовки секций, символы,
+//// индекс имён, а для каждой секции с кодом - метки и битовая карта начал команд. Карта (бит
+//// на полуслово, 1/16 размера кода) вместо массива Instruction (около 8 размеров кода):
+//// команда по известному началу декодируется за наносекунды.
+class Server_Image {
+public:
+    explicit Server_Image(const std::string& filename);
+    Server_Image(const Server_Image&) = delete;
+    Server_Image& operator=(const Server_Image&) = delete;
+
+    //// Оценка занятой памяти, включая отображённый файл.
+    uint64_t memory() const;
+
+    //// Команды, начинающиеся в [begin, end), в формате листинга --start/--stop.
+    void write_range(uint64_t begin, uint64_t end, Output_Buffer& output) const;
+
+    //// Определённые символы с именем name (без STT_SECTION/STT_FILE), в порядке адресов.
+    std::vector<uint32_t> find_symbols(std::string_view name) const;
+    const Symbol_Table& symbols() const;
+    std::string_view section_name(uint32_t symbol) const;
+
+    //// Команда, которой принадлежит address; false - адрес вне секций с кодом или в обрывке.
+    //// function - "имя+0x10" ближайшей предшествующей функции секции, line - строка листинга.
+    bool instruction_at(uint64_t address, Instruction& inst, std::string& function, std::string& line) const;
+
+private:
+    struct Code_Section {
+        Code_Section(const Elf_Image& image, const Section& section, const RWer& rw);
+
+        Section_Info info;
+        const uint8_t* text;
+        Text_Scan scan;
+        Label_Index labels;
+        //// FUNC символы секции по возрастанию адреса.
+        std::vector<uint32_t> functions;
+    };
+
+    Elf_Image _image;
+    ELF_Header _header;
+    Section_Index _sections;
+    Section_Info _text, _symtab, _strtab;
+    RWer _rw;
+    std::vector<std::unique_ptr<Code_Section>> _code;
+    //// Номера символов по именам.
+    std::vector<uint32_t> _by_name;
+};
+
+//// Разобранные образы в памяти: ключ - путь, размер и время изменения файла, при превышении
+//// предела вытесняются дольше всех не использовавшиеся. Только что загруженный образ остаётся,
+//// даже если один больше предела.
+class Image_Cache {
+public:
+    explicit Image_Cache(uint64_t limit = DEFAULT_IMAGE_CACHE_SIZE);
+
+    //// Образ для файла; изменившийся с прошлого запроса файл разбирается заново.
+    const Server_Image& get(const std::string& filename);
+
+    size_t size() const;
+    uint64_t memory() const;
+    uint64_t limit() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t evictions() const;
+
+private:
+    struct Entry {
+        std::string filename;
+        uint64_t size;
+        int64_t mtime;
+        std::unique_ptr<Server_Image> image;
+        uint64_t memory;
+    };
+
+    void evict();
+
+    //// Начало списка - самый свежий образ.
+    std::list<Entry> _entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> _by_name;
+    uint64_t _limit;
+    uint64_t _memory = 0;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _evictions = 0;
+};
+
+//// Ответ (кадр целиком) на запрос по протоколу server_protocol.h. Ошибки разбора образа и
+//// неверные запросы возвращаются клиенту ответом ERROR.
+std::string handle_request(Image_Cache& cache, std::string_view request);
+
+//// Слушает Unix сокет socket_path и обслуживает клиентов по очереди в одном потоке до
+//// SIGINT/SIGTERM; сокет удаляется при выходе.
+void run_server(const std::string& socket_path, uint64_t memory_limit);
@@ -1,100 +1,21 @@
 #pragma once
 #include <iostream>
-#include <string>
+#include <string_view>
+#include "decoder.h"
+#include "label_index.h"
+#include "output_buffer.h"
 
 
 uint32_t get_bits(uint32_t n, size_t pos, size_t len);
 
-void write_big_instruction(std::ofstream& output, uint32_t num, uint32_t big_inst, std::string label);
-
-class R_type {
-public:
-    explicit R_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string to_string() const;
-
-
-private:
-    uint8_t opcode;
-    uint8_t fun3;
-    uint8_t fun7;
-    uint8_t rs1;
-    uint8_t rs2;
-    uint8_t rd;
-};
-
-class I_type {
-public:
-    explicit I_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string imm_to_str() const;
-    std::string to_string() const;
-
-private:
-    uint8_t opcode;
-    uint8_t fun3;
-    uint8_t rs1;
-    uint8_t rd;
-    uint32_t imm;
-};
-
-class S_type {
-public:
-    explicit S_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string imm_to_str() const;
-    std::string to_string() const;
-
-private:
-    uint8_t opcode;
-    uint8_t fun3;
-    uint8_t rs1;
-    uint8_t rs2;
-    uint32_t imm;
-};
-
-class B_type {
-public:
-    explicit B_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string imm_to_str() const;
-    std::string to_string() const;
-
-private:
-    uint8_t opcode;
-    uint8_t fun3;
-    uint8_t rs1;
-    uint8_t rs2;
-    uint32_t imm;
-};
-
-class U_type {
-public:
-    explicit U_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string imm_to_str() const;
-    std::string to_string() const;
-
-private:
-    uint8_t opcode;
-    uint8_t rd;
-    uint32_t imm;
-};
-
-class J_type {
-public:
-    explicit J_type(uint32_t s_command);
-    std::string command_to_string() const;
-    std::string imm_to_str() const;
-    std::string to_string() const;
-
-private:
-    uint8_t opcode;
-    uint8_t rd;
-    uint32_t imm;
-};
-
-
-
+std::string_view reg_name(uint32_t reg);
+std::string_view freg_name(uint32_t reg);
+//// Имя известного CSR, иначе пустая строка.
+std::string_view csr_name(uint32_t csr);
 
+//// С targets у переходов после смещения печатается метка цели: "beq a0, zero, 8 <L_00010008>".
+void write_instruction(Output_Buffer& output, const Instruction& inst,
+                       const Label_Index::Cursor* targets = nullptr);
 
+void write_instruction_line(Output_Buffer& output, const Instruction& inst, std::string_view label,
+                            const Label_Index::Cursor* targets = nullptr);
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "listing_cache.h"
+#include "options.h"
+#include "thread_pool.h"
+
+
+struct File_Result {
+    std::string input;
+    std::string output;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t instructions = 0;
+    double seconds = 0;
+    std::string error;
+};
+
+//// Ошибки разбора не выбрасываются наружу, а сохраняются в File_Result::error,
+//// чтобы сбой одного файла не прерывал обработку остальных.
+File_Result disassemble_file(const std::string& input, const std::string& output, const Options& options,
+                             Thread_Pool* pool, Listing_Cache* cache = nullptr);
+
+//// nullptr, если кэш отключён, не нужен для выбранного формата или каталог не создаётся.
+std::unique_ptr<Listing_Cache> open_listing_cache(const Options& options);
+
+std::vector<std::string> collect_batch_inputs(const Options& options);
+
+//// Возвращает количество файлов, обработанных с ошибкой.
+size_t run_batch(const Options& options, Thread_Pool& pool);
+
+//// Отчёт --diff в файл или stdout, возвращает количество изменённых, добавленных и удалённых функций.
+size_t run_diff(const Options& options, Thread_Pool* pool);
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "output_buffer.h"
+#include "thread_pool.h"
+
+
+//// Итог сравнения: функции сопоставляются по имени (одноимённые - по порядку адресов).
+struct Diff_Summary {
+    size_t old_functions = 0;
+    size_t new_functions = 0;
+    //// Байты совпали.
+    size_t identical = 0;
+    //// Совпали после замены адресов на "символ + смещение": сдвинута сама функция или то, на что она ссылается.
+    size_t relocated = 0;
+    size_t changed = 0;
+    size_t added = 0;
+    size_t removed = 0;
+};
+
+//// Отчёт о различиях двух сборок (--diff): изменённые функции с разницей по командам
+//// (смещения от начала функции, адреса целей нормализованы), добавленные и удалённые
+//// функции, в конце итог. Одинаковые функции отсеиваются по хэшу байтов без декодирования.
+Diff_Summary write_elf_diff(const std::string& old_file, const std::string& new_file, Output_Buffer& output,
+                            Thread_Pool* pool = nullptr);
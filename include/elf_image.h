@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+const std::string STDIN_NAME = "-";
+const size_t STREAM_BLOCK_SIZE = 1 << 20;
+
+//// Весь ELF файл целиком: отображается в память (mmap) только для чтения,
+//// либо, если отобразить не получилось, читается одним вызовом в буфер.
+//// Все дальнейшие разборы идут по этой памяти без файлового ввода-вывода.
+class Elf_Image {
+public:
+    explicit Elf_Image(const std::string& filename);
+    //// Копия готового буфера (например, входа fuzz-теста).
+    Elf_Image(const uint8_t* data, size_t size);
+    ~Elf_Image();
+    Elf_Image(const Elf_Image&) = delete;
+    Elf_Image& operator=(const Elf_Image&) = delete;
+
+    size_t size() const;
+    bool is_mapped() const;
+
+    //// Подсказка, что диапазон больше не нужен и его страницы можно вернуть системе.
+    void release(size_t offset, size_t size) const;
+
+    const uint8_t* data(size_t offset, size_t size) const;
+
+    std::string_view read_string(size_t table_offset, size_t table_size, size_t index) const;
+
+    template<typename T>
+    T read(size_t offset) const {
+        T value;
+        std::memcpy(&value, data(offset, sizeof(T)), sizeof(T));
+        return value;
+    }
+
+private:
+    void map_file(int fd);
+    void load_stream();
+    //// Вход без перемотки (канал, FIFO): во временный файл блоками, затем mmap.
+    void spool_stream(int fd);
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::vector<uint8_t> _buffer;
+};
+
+
+//// Типизированное окно на таблицу одинаковых записей внутри образа.
+//// Границы проверяются один раз при создании, доступ к элементам без проверок.
+template<typename T>
+class Elf_Table {
+public:
+    Elf_Table() = default;
+    Elf_Table(const Elf_Image& image, size_t offset, size_t count, size_t entsize = sizeof(T)):
+            _base(image.data(offset, count * entsize)),
+            _count(count),
+            _entsize(entsize) {}
+
+    size_t size() const { return _count; }
+
+    T operator[](size_t i) const {
+        T value;
+        std::memcpy(&value, _base + i * _entsize, sizeof(T));
+        return value;
+    }
+
+private:
+    const uint8_t* _base = nullptr;
+    size_t _count = 0;
+    size_t _entsize = sizeof(T);
+};
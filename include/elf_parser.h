@@ -1,8 +1,16 @@
 #pragma once
 #include <exception>
 #include <string>
-#include <map>
+#include <ostream>
 #include <vector>
+#include "cfg.h"
+#include "decoder.h"
+#include "elf_image.h"
+#include "label_index.h"
+#include "listing_cache.h"
+#include "output_buffer.h"
+#include "section_index.h"
+#include "thread_pool.h"
 
 
 class DisassemblerException: public std::exception {
@@ -16,33 +24,151 @@ private:
 
 
 const size_t E_HEADER_SIZE = 52;
+const size_t EI_NIDENT = 16;
 const char EI_MAG0 = 0x7f;
 const char EI_MAG1 = 0x45;
 const char EI_MAG2 = 0x4c;
 const char EI_MAG3 = 0x46;
 const char ELFCLASS32 = 0x01;
+const char ELFCLASS64 = 0x02;
 const char ELFDATA2LSB = 0x01;
 const char EV_CURRENT = 0x01;
-const size_t E_SHOFF_POS = 32;
-const size_t E_SINFO_POS = 46;
-const size_t E_TI_POS = 50;
-const size_t S_OFFSET_INFO = 16;
 
+struct Elf32_Header {
+    unsigned char e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct Elf32_Section {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint32_t sh_flags;
+    uint32_t sh_addr;
+    uint32_t sh_offset;
+    uint32_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint32_t sh_addralign;
+    uint32_t sh_entsize;
+};
+
+struct Elf32_Symbol {
+    uint32_t st_name;
+    uint32_t st_value;
+    uint32_t st_size;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+};
+
+struct Elf64_Header {
+    unsigned char e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct Elf64_Section {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+};
+
+struct Elf64_Symbol {
+    uint32_t st_name;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+};
+
+static_assert(sizeof(Elf32_Header) == E_HEADER_SIZE, "Elf32_Header layout");
+static_assert(sizeof(Elf32_Section) == 40, "Elf32_Section layout");
+static_assert(sizeof(Elf32_Symbol) == 16, "Elf32_Symbol layout");
+static_assert(sizeof(Elf64_Header) == 64, "Elf64_Header layout");
+static_assert(sizeof(Elf64_Section) == 64, "Elf64_Section layout");
+static_assert(sizeof(Elf64_Symbol) == 24, "Elf64_Symbol layout");
+
+//// Раскладки записей для класса ELF. Разбор заголовков и символов - шаблоны по этим
+//// типам: класс проверяется один раз на файл, внутренние циклы от него не зависят.
+struct Elf32 {
+    using Header = Elf32_Header;
+    using Section_Header = Elf32_Section;
+    using Symbol = Elf32_Symbol;
+    static const char CLASS = ELFCLASS32;
+    static const Xlen XLEN = Xlen::RV32;
+};
+
+struct Elf64 {
+    using Header = Elf64_Header;
+    using Section_Header = Elf64_Section;
+    using Symbol = Elf64_Symbol;
+    static const char CLASS = ELFCLASS64;
+    static const Xlen XLEN = Xlen::RV64;
+};
+
+//// Секция, которую разбирает RWer. index == 0 - номер неизвестен, тогда метками
+//// служат все символы, а не только определённые в этой секции.
 struct Section_Info {
-    uint32_t sh_offset = 0;
+    uint64_t sh_offset = 0;
     uint32_t sh_size = 0;
+    uint64_t sh_addr = 0;
+    uint32_t index = 0;
+    std::string_view name = ".text";
 };
 
+Section_Info section_info(const Section& section);
+
 class ELF_Header {
 public:
-    explicit ELF_Header(std::ifstream& input);
-    void search_sections_info(std::ifstream& input,
+    explicit ELF_Header(const Elf_Image& image);
+    char elf_class() const;
+    Section_Index section_index(const Elf_Image& image) const;
+    void search_sections_info(const Elf_Image& image,
                               Section_Info& s_i_text,
                               Section_Info& s_i_symtable,
-                              Section_Info& shstrtab) const;
+                              Section_Info& strtab) const;
+    void search_sections_info(const Section_Index& sections,
+                              Section_Info& s_i_text,
+                              Section_Info& s_i_symtable,
+                              Section_Info& strtab) const;
 
 private:
-    uint32_t e_shoff = 0;
+    template<typename Elf>
+    void read_header(const Elf_Image& image);
+
+    char _class = ELFCLASS32;
+    uint64_t e_shoff = 0;
     uint16_t e_shentsize = 0;
     uint16_t e_shnum = 0;
     uint16_t e_shstrndx = 0;
@@ -51,31 +177,97 @@ private:
 
 const size_t BIG_INST_SIZE = 4;
 const size_t SMALL_INST_SIZE = 2;
-const size_t STR_SYMTAB_SIZE = 16;
-
-struct Str_Symtab {
-    void write(std::ofstream& output, size_t i) const;
-    uint32_t value;
-    uint32_t size;
-    unsigned char info;
-    unsigned char other;
-    uint16_t index;
-    std::string name;
+const uint32_t TEXT_CHUNK_SIZE = 1 << 18;
+const unsigned char STT_FUNC = 2;
+const unsigned char STT_SECTION = 3;
+const unsigned char STT_FILE = 4;
+
+//// Смещения функции (FUNC из .symtab) внутри секции: [begin, end).
+struct Function_Range {
+    uint32_t begin;
+    uint32_t end;
+};
+
+//// Адреса [begin, end) для выборочного разбора (--start/--stop, --symbol).
+struct Address_Range {
+    uint64_t begin;
+    uint64_t end;
+};
+
+//// Сортирует и сливает пересекающиеся диапазоны.
+std::vector<Address_Range> merge_ranges(std::vector<Address_Range> ranges);
+
+//// Таблица символов в виде структуры массивов. Имена не копируются:
+//// хранится смещение в таблице строк образа, name() возвращает string_view на неё.
+struct Symbol_Table {
+    void reserve(size_t count);
+    size_t size() const;
+    std::string_view name(size_t i) const;
+    void write(Output_Buffer& output, size_t i) const;
+
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> sizes;
+    std::vector<unsigned char> infos;
+    std::vector<unsigned char> others;
+    std::vector<uint16_t> indices;
+    std::vector<uint32_t> name_offsets;
+    const char* strtab = nullptr;
+    size_t strtab_size = 0;
 };
 
 class RWer {
 public:
-    explicit RWer(Section_Info* s_i_text, Section_Info* s_i_symtable, Section_Info* shstrtab);
-    void processing_text(std::ifstream& input, std::ofstream& output);
-    void processing_symtable(std::ifstream& input, std::ofstream& output);
-    void write_symtab(std::ofstream& output);
+    explicit RWer(Section_Info* s_i_text, Section_Info* s_i_symtable, Section_Info* strtab,
+                  char elf_class = ELFCLASS32);
+    //// С кэшем текст неизменившихся функций берётся из него, а не декодируется заново.
+    size_t processing_text(const Elf_Image& image, Output_Buffer& output, Thread_Pool* pool = nullptr,
+                           Listing_Cache* cache = nullptr);
+    //// Только команды, начинающиеся в ranges (отсортированы, без пересечений). Читаются и
+    //// декодируются лишь нужные байты; секция без пересечений с ranges не выводится.
+    size_t processing_text_ranges(const Elf_Image& image, Output_Buffer& output,
+                                  const std::vector<Address_Range>& ranges);
+    size_t processing_text_binary(const Elf_Image& image, std::ostream& output);
+    void processing_symtable(const Elf_Image& image);
+    //// Граф потока управления текущей секции. С synthesize_labels цели переходов без символа
+    //// получают метки L_xxxxxxxx, а переходы в листинге - имя цели; кэш листинга тогда не используется.
+    Control_Flow_Graph analyze_control_flow(const Elf_Image& image, Thread_Pool* pool, bool synthesize_labels);
+    //// Диапазоны символов по именам через отсортированный по именам индекс. Символ без размера
+    //// продолжается до следующего символа своей секции.
+    std::vector<Address_Range> symbol_ranges(const std::vector<std::string>& names) const;
+    void write_symtab(Output_Buffer& output);
+    //// Метки секции с номером index (0 - все символы), независимо от текущей секции.
+    Label_Index section_labels(uint32_t index) const;
+    //// Номера символов секции index в порядке .symtab.
+    std::vector<uint32_t> section_symbols(uint32_t index) const;
+    const Symbol_Table& symbol_table() const;
+    const Label_Index& label_index() const;
+    Xlen xlen() const;
 
 private:
-    std::vector<Str_Symtab> v_str_symtab;
-    std::map<uint32_t, std::string> labels;
+    template<typename Elf>
+    void load_symbols(const Elf_Image& image);
+    uint32_t write_text_range(const uint8_t* text, uint32_t begin, uint32_t end, Output_Buffer& output,
+                              size_t& count) const;
+    std::vector<uint32_t> section_symbols() const;
+    void build_labels(const Control_Flow_Graph* cfg = nullptr);
+    std::vector<Function_Range> function_ranges() const;
+    uint32_t write_text_cached(const uint8_t* text, uint32_t begin, uint32_t end,
+                               const std::vector<Function_Range>& functions, Listing_Cache& cache,
+                               Output_Buffer& output, size_t& count) const;
+    uint32_t write_function(const uint8_t* text, Function_Range function, Listing_Cache& cache,
+                            Output_Buffer& output, size_t& count) const;
+    bool splice_function(const Cache_Entry& entry, uint64_t address, uint32_t size, Output_Buffer& output) const;
+
+    Symbol_Table symbols;
+    std::vector<uint32_t> by_section;
+    //// Метки секции s_i_text, перестраиваются при смене секции.
+    Label_Index labels;
+    uint32_t labels_section = 0;
+    bool annotate_targets = false;
     Section_Info* s_i_text;
     Section_Info* s_i_symtable;
-    Section_Info* shstrtab;
+    Section_Info* strtab;
+    char elf_class;
 };
 
 
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+//// XXH64 (совместим с эталонной реализацией xxHash).
+uint64_t xxhash64(const void* data, size_t size, uint64_t seed = 0);
+
+inline uint64_t xxhash64(std::string_view data, uint64_t seed = 0) {
+    return xxhash64(data.data(), data.size(), seed);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstring>
+#include <iterator>
+#include "decoder.h"
+
+
+//// Ленивый проход по байтам кода: команда декодируется только при продвижении итератора.
+//// Обрывок команды в конце диапазона не выдаётся.
+class Instruction_Iterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Instruction;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Instruction*;
+    using reference = const Instruction&;
+
+    Instruction_Iterator() = default;
+    Instruction_Iterator(const uint8_t* data, size_t size, size_t offset, uint64_t address,
+                         Xlen xlen = Xlen::RV32):
+            _data(data),
+            _size(size),
+            _offset(offset),
+            _address(address),
+            _xlen(xlen) {
+        decode();
+    }
+
+    reference operator*() const { return _current; }
+    pointer operator->() const { return &_current; }
+
+    Instruction_Iterator& operator++() {
+        _offset += _current.length;
+        decode();
+        return *this;
+    }
+
+    Instruction_Iterator operator++(int) {
+        Instruction_Iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const Instruction_Iterator& other) const {
+        if (!_valid || !other._valid) return _valid == other._valid;
+        return _data == other._data && _offset == other._offset;
+    }
+    bool operator!=(const Instruction_Iterator& other) const { return !(*this == other); }
+
+    //// Смещение текущей команды от начала диапазона (или место остановки).
+    size_t offset() const { return _offset; }
+
+private:
+    void decode() {
+        _valid = false;
+        if (_size - _offset < 2) return;
+        uint16_t low;
+        std::memcpy(&low, _data + _offset, sizeof(low));
+        if (instruction_length(low) == 4) {
+            if (_size - _offset < 4) return;
+            uint32_t raw;
+            std::memcpy(&raw, _data + _offset, sizeof(raw));
+            _current = decode_instruction(raw, _address + _offset, _xlen);
+        }
+        else {
+            _current = decode_compressed(low, _address + _offset, _xlen);
+        }
+        _valid = true;
+    }
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    size_t _offset = 0;
+    uint64_t _address = 0;
+    Xlen _xlen = Xlen::RV32;
+    Instruction _current{};
+    bool _valid = false;
+};
+
+class Instruction_Range {
+public:
+    Instruction_Range(const uint8_t* data, size_t size, uint64_t address = 0, Xlen xlen = Xlen::RV32):
+            _data(data),
+            _size(size),
+            _address(address),
+            _xlen(xlen) {}
+
+    Instruction_Iterator begin() const { return Instruction_Iterator(_data, _size, 0, _address, _xlen); }
+    Instruction_Iterator end() const { return Instruction_Iterator(); }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    uint64_t _address;
+    Xlen _xlen;
+};
+
+//// Вызывает visit(const Instruction&) для каждой команды, возвращает их количество.
+template<typename Visitor>
+size_t for_each_instruction(const uint8_t* data, size_t size, uint64_t address, Visitor&& visit,
+                            Xlen xlen = Xlen::RV32) {
+    size_t count = 0;
+    for (const Instruction& inst : Instruction_Range(data, size, address, xlen)) {
+        visit(inst);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+//// Метки из .symtab: отсортированный массив (адрес, смещение имени) и одна строка-арена
+//// со всеми именами. Строится один раз, дальше только читается.
+class Label_Index {
+public:
+    void reserve(size_t count);
+    void add(uint64_t address, std::string_view name);
+    //// При совпадении адресов остаётся метка, добавленная последней.
+    void build();
+
+    size_t size() const;
+    std::string_view find(uint64_t address) const;
+    //// Арена имён: метки, возвращаемые find и Cursor, указывают внутрь неё.
+    std::string_view names() const;
+    //// Хэш меток в [begin, end): смещения от begin и имена, продолжает seed.
+    uint64_t hash_range(uint64_t begin, uint64_t end, uint64_t seed) const;
+
+    //// Проход по возрастающим адресам без поиска: O(1) в среднем на запрос.
+    class Cursor {
+    public:
+        Cursor(const Label_Index& index, uint64_t start);
+        std::string_view at(uint64_t address);
+        //// Метка по любому адресу: поиск расходится от текущей позиции, поэтому близкие
+        //// адреса (цели переходов) находятся за O(log расстояния).
+        std::string_view find(uint64_t address) const;
+
+    private:
+        const Label_Index* _index;
+        size_t _pos;
+    };
+
+private:
+    struct Entry {
+        uint64_t address;
+        uint32_t name_offset;
+        uint32_t name_size;
+    };
+
+    size_t lower_bound(uint64_t address) const;
+    std::string_view name(const Entry& entry) const;
+
+    std::vector<Entry> _entries;
+    std::string _names;
+};
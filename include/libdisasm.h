@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "decoder.h"
+#include "elf_image.h"
+#include "elf_parser.h"
+#include "instruction_iterator.h"
+
+
+//// Разобранный ELF файл для использования дизассемблера как библиотеки:
+//// команды .text (или любой секции) выдаются записями Instruction, без форматирования текста.
+class Elf_Disassembly {
+public:
+    explicit Elf_Disassembly(const std::string& filename);
+    Elf_Disassembly(const Elf_Disassembly&) = delete;
+    Elf_Disassembly& operator=(const Elf_Disassembly&) = delete;
+
+    const Elf_Image& image() const;
+    const Section_Index& sections() const;
+    const Symbol_Table& symbols() const;
+    //// Метка по адресу в .text.
+    std::string_view label(uint64_t address) const;
+    Instruction_Range instructions() const;
+    Instruction_Range instructions(const Section& section) const;
+
+    template<typename Visitor>
+    size_t for_each_instruction(Visitor&& visit) const {
+        size_t count = 0;
+        for (const Instruction& inst : instructions()) {
+            visit(inst);
+            count++;
+        }
+        return count;
+    }
+
+private:
+    Elf_Image _image;
+    ELF_Header _header;
+    Section_Index _sections;
+    Section_Info _text, _symtab, _strtab;
+    RWer _rw;
+};
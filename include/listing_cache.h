@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+//// Меняется при любом изменении формата строк листинга: старые записи просто не находятся.
+const uint32_t LISTING_CACHE_VERSION = 2;
+const uint64_t DEFAULT_CACHE_SIZE = 1ull << 30;
+//// Функции короче этого декодировать дешевле, чем читать файл из кэша.
+const uint32_t CACHE_MIN_FUNCTION_SIZE = 256;
+
+//// Готовые строки листинга одной функции, выведенной с адреса address, и длины её команд.
+//// Ключ от адреса не зависит: у сдвинутой функции при вставке переписывается колонка адресов.
+struct Cache_Entry {
+    uint64_t address = 0;
+    std::vector<uint8_t> lengths;
+    std::string lines;
+};
+
+//// Кэш на диске, по файлу на ключ. При превышении лимита удаляются записи,
+//// которые дольше всех не читались (время изменения файла обновляется при чтении).
+//// Ошибки ввода-вывода не выбрасываются: кэш только ускоряет работу.
+class Listing_Cache {
+public:
+    explicit Listing_Cache(std::string directory, uint64_t max_size = DEFAULT_CACHE_SIZE);
+
+    bool load(uint64_t key, Cache_Entry& entry) const;
+    void store(uint64_t key, const Cache_Entry& entry);
+
+    const std::string& directory() const;
+
+private:
+    std::string path(uint64_t key) const;
+    void evict();
+
+    std::string _directory;
+    uint64_t _max_size;
+    std::mutex _mutex;
+    bool _scanned = false;
+    uint64_t _size = 0;
+};
+
+//// $XDG_CACHE_HOME/lab_03 или ~/.cache/lab_03, пустая строка, если ни то ни другое не задано.
+std::string default_cache_dir();
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cfg.h"
+#include "decoder.h"
+#include "disasm_server.h"
+#include "listing_cache.h"
+#include "stats.h"
+
+
+enum class Output_Format {
+    TEXT, BIN
+};
+
+struct Options {
+    size_t jobs = 1;
+    Output_Format format = Output_Format::TEXT;
+    //// Вход - двоичный листинг (--format=bin), выход - его текстовый вид.
+    bool from_bin = false;
+    bool batch = false;
+    //// Сравнение двух сборок: inputs - старый ELF, новый ELF и, возможно, файл отчёта.
+    bool diff = false;
+    //// Сервер на Unix сокете inputs[0] с образами в памяти в пределах memory_limit.
+    bool serve = false;
+    uint64_t memory_limit = DEFAULT_IMAGE_CACHE_SIZE;
+    std::string output_dir = ".";
+    std::string manifest;
+    //// Кэш текста функций между запусками: только по --cache или --cache-dir, чтобы обычный
+    //// запуск ничего не писал в домашний каталог.
+    bool cache = false;
+    std::string cache_dir = default_cache_dir();
+    uint64_t cache_size = DEFAULT_CACHE_SIZE;
+    //// Метки L_xxxxxxxx у целей переходов и имена целей в листинге.
+    bool labels = false;
+    //// Файл для графа потока управления (пусто - не строить).
+    std::string cfg_file;
+    Cfg_Format cfg_format = Cfg_Format::DOT;
+    //// Время этапов и счётчики в stderr по окончании работы.
+    bool stats = false;
+    Stats_Format stats_format = Stats_Format::TABLE;
+    //// Выводятся только команды из [start, stop) и функций symbols (пусто - все).
+    uint64_t start = 0;
+    uint64_t stop = UINT64_MAX;
+    std::vector<std::string> symbols;
+    //// Расширения ISA из --march, по умолчанию все поддерживаемые.
+    Extension_Set extensions = ALL_EXTENSIONS;
+    //// Размер буфера вывода (0 - по умолчанию) и запись в фоновом потоке.
+    size_t buffer_size = 0;
+    bool async_write = false;
+    std::vector<std::string> inputs;
+};
+
+Options parse_options(int argc, char** argv);
+bool has_address_filter(const Options& options);
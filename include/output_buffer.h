@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "output_sink.h"
+
+
+const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+const size_t STREAM_OUTPUT_BUFFER_SIZE = 1 << 16;
+const std::string_view STDOUT_NAME = "-";
+
+//// Буфер для вывода текста без выделений памяти на каждую строку.
+//// Если задан поток или приёмник, содержимое сбрасывается в него большими блоками при заполнении,
+//// иначе буфер просто растёт (например, для вывода куска .text в отдельном потоке).
+class Output_Buffer {
+public:
+    explicit Output_Buffer(std::ostream* output = nullptr, size_t capacity = OUTPUT_BUFFER_SIZE);
+    explicit Output_Buffer(Output_Sink* sink, size_t capacity = OUTPUT_BUFFER_SIZE);
+    ~Output_Buffer();
+    Output_Buffer(const Output_Buffer&) = delete;
+    Output_Buffer& operator=(const Output_Buffer&) = delete;
+
+    void append(std::string_view str) {
+        reserve(str.size());
+        std::char_traits<char>::copy(_buffer.data() + _used, str.data(), str.size());
+        _used += str.size();
+    }
+    void put(char c) {
+        reserve(1);
+        _buffer[_used++] = c;
+    }
+    void pad(size_t count, char c = ' ');
+    void append_dec(int64_t value);
+    void append_udec(uint64_t value, size_t width = 0);
+    size_t append_hex(uint64_t value, size_t min_width, bool upper = false);
+
+    void append_right(std::string_view str, size_t width) {
+        if (str.size() < width) pad(width - str.size());
+        append(str);
+    }
+    void append_left(std::string_view str, size_t width) {
+        append(str);
+        if (str.size() < width) pad(width - str.size());
+    }
+
+    //// Большие блоки при наличии приёмника пишутся в него напрямую вместе с буфером, без копирования.
+    void append_block(std::string_view block);
+
+    std::string_view view() const;
+    void clear();
+    void flush();
+
+private:
+    void reserve(size_t count) {
+        if (_used + count > _buffer.size()) grow(count);
+    }
+    void grow(size_t count);
+
+    std::unique_ptr<Output_Sink> _stream_sink;
+    Output_Sink* _sink;
+    std::vector<char> _buffer;
+    size_t _used = 0;
+};
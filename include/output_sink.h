@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+//// Куда Output_Buffer сбрасывает заполненный буфер. Ошибка записи не бросает исключение:
+//// дальнейшие записи пропускаются, а good() возвращает false (как у std::ostream).
+class Output_Sink {
+public:
+    virtual ~Output_Sink() = default;
+    virtual void write(std::string_view data) = 0;
+    //// Два куска подряд, по возможности одним системным вызовом (writev).
+    virtual void write(std::string_view first, std::string_view second);
+    //// Отдаёт заполненный буфер; фоновая запись забирает его, а в buffer кладёт свободный
+    //// не меньшего размера.
+    virtual void write_buffer(std::vector<char>& buffer, size_t size);
+    virtual void flush() {}
+    virtual bool good() const = 0;
+    //// Сколько байт записано.
+    virtual uint64_t written() const = 0;
+};
+
+class Stream_Sink: public Output_Sink {
+public:
+    explicit Stream_Sink(std::ostream& output);
+    //// Открывает файл сам; при ошибке good() == false.
+    explicit Stream_Sink(const std::string& filename);
+
+    void write(std::string_view data) override;
+    void flush() override;
+    bool good() const override;
+    uint64_t written() const override;
+
+private:
+    std::unique_ptr<std::ofstream> _file;
+    std::ostream* _output;
+    uint64_t _written = 0;
+};
+
+//// Запись в файловый дескриптор через write/writev, минуя буферы std::ostream.
+class Fd_Sink: public Output_Sink {
+public:
+    explicit Fd_Sink(int fd, bool owned = false);
+    ~Fd_Sink() override;
+    Fd_Sink(const Fd_Sink&) = delete;
+    Fd_Sink& operator=(const Fd_Sink&) = delete;
+
+    void write(std::string_view data) override;
+    void write(std::string_view first, std::string_view second) override;
+    bool good() const override;
+    uint64_t written() const override;
+
+private:
+    int _fd;
+    bool _owned;
+    bool _good = true;
+    uint64_t _written = 0;
+};
+
+//// Двойная буферизация: заполненный буфер пишет фоновый поток, пока форматируется следующий.
+class Async_Sink: public Output_Sink {
+public:
+    explicit Async_Sink(std::unique_ptr<Output_Sink> target);
+    ~Async_Sink() override;
+    Async_Sink(const Async_Sink&) = delete;
+    Async_Sink& operator=(const Async_Sink&) = delete;
+
+    void write(std::string_view data) override;
+    void write_buffer(std::vector<char>& buffer, size_t size) override;
+    void flush() override;
+    bool good() const override;
+    uint64_t written() const override;
+
+private:
+    void run();
+    //// Ждёт, пока фоновый поток допишет предыдущий буфер; вызывается под _mutex.
+    void wait_idle(std::unique_lock<std::mutex>& lock);
+
+    std::unique_ptr<Output_Sink> _target;
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _changed;
+    std::vector<char> _pending;
+    size_t _pending_size = 0;
+    bool _busy = false;
+    bool _stop = false;
+    std::thread _thread;
+};
+
+//// Файл (или stdout для STDOUT_NAME) для вывода листинга, nullptr - не удалось открыть.
+std::unique_ptr<Output_Sink> open_output_sink(const std::string& filename, bool async);
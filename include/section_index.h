@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "elf_image.h"
+
+
+const uint32_t SHT_SYMTAB = 2;
+const uint32_t SHT_STRTAB = 3;
+const uint32_t SHT_NOBITS = 8;
+const uint32_t SHF_EXECINSTR = 0x4;
+
+struct Section {
+    std::string_view name;
+    uint32_t index;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t entsize;
+};
+
+//// Таблица заголовков секций, разобранная за один проход: имена указывают в shstrtab образа,
+//// поиск по имени через хэш-таблицу. В том же проходе проверяется, что каждая секция (кроме
+//// SHT_NOBITS) лежит в файле, иначе DisassemblerException с номером и именем секции.
+class Section_Index {
+public:
+    Section_Index() = default;
+    //// elf_class - ELFCLASS32 или ELFCLASS64, от него зависит раскладка заголовков.
+    Section_Index(const Elf_Image& image, char elf_class, uint64_t shoff, uint16_t shnum, uint16_t shentsize,
+                  uint16_t shstrndx);
+
+    size_t size() const;
+    const Section& operator[](size_t i) const;
+    //// При повторяющихся именах находится первая секция; nullptr, если такой нет.
+    const Section* find(std::string_view name) const;
+    std::vector<const Section*> with_type(uint32_t type) const;
+    std::vector<const Section*> with_flags(uint32_t flags) const;
+    //// Секции с кодом (SHF_EXECINSTR, не SHT_NOBITS) в порядке таблицы заголовков.
+    std::vector<const Section*> executable() const;
+
+    const uint8_t* data(const Elf_Image& image, const Section& section) const;
+
+private:
+    template<typename Elf>
+    void load(const Elf_Image& image, uint64_t shoff, uint16_t shnum, uint16_t shentsize, uint16_t shstrndx);
+
+    std::vector<Section> _sections;
+    std::unordered_map<std::string_view, uint32_t> _names;
+};
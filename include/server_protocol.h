@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+//// Протокол сервера (--serve): кадр - длина полезной нагрузки (uint32, little-endian) и сама нагрузка.
+//// Запрос начинается с Request_Type, ответ - с Response_Status; числа little-endian,
+//// строки - длина uint32 и байты. При ERROR в ответе одна строка - текст ошибки.
+//// DISASSEMBLE: путь, begin, end (uint64)  -> листинг [begin, end) как у --start/--stop.
+//// SYMBOL:      путь, имя                  -> число символов (uint32), для каждого адрес, размер
+////                                            (uint64), st_info (uint8), имя секции.
+//// INSTRUCTION: путь, адрес (uint64)       -> начало команды (uint64), код (uint32), длина (uint8),
+////                                            функция ("имя+0x10"), строка листинга.
+//// STATUS:                                 -> образов (uint32), занято, предел, попаданий, промахов,
+////                                            вытеснений (uint64).
+enum class Request_Type : uint8_t {
+    DISASSEMBLE = 1, SYMBOL = 2, INSTRUCTION = 3, STATUS = 4
+};
+
+enum class Response_Status : uint8_t {
+    OK = 0, ERROR = 1
+};
+
+const size_t FRAME_HEADER_SIZE = 4;
+const size_t MAX_REQUEST_SIZE = 1 << 16;
+const size_t MAX_RESPONSE_SIZE = 1 << 28;
+
+class Message_Writer {
+public:
+    void put_u8(uint8_t value);
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_string(std::string_view value);
+    //// Кадр целиком: заголовок с длиной уже на месте.
+    std::string_view frame();
+
+private:
+    std::string _data = std::string(FRAME_HEADER_SIZE, '\0');
+};
+
+//// Чтение нагрузки кадра; выход за её конец - DisassemblerException.
+class Message_Reader {
+public:
+    explicit Message_Reader(std::string_view data);
+    uint8_t get_u8();
+    uint32_t get_u32();
+    uint64_t get_u64();
+    std::string_view get_string();
+    bool done() const;
+
+private:
+    std::string_view take(size_t size);
+
+    std::string_view _data;
+};
+
+//// Длина нагрузки из заголовка кадра.
+uint32_t frame_size(const char* header);
+
+//// Блокирующие запись и чтение кадра целиком; false - ошибка, конец потока или кадр больше max_size.
+bool write_frame(int fd, std::string_view frame);
+bool read_frame(int fd, std::string& payload, size_t max_size);
@@ -0,0 +1,128 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include "decoder.h"
+
+
+//// Встроенная статистика (--stats): время этапов и счётчики. Собирается с DISASM_STATS
+//// (опция CMake, по умолчанию включена); без неё все вызовы ниже - пустые inline функции.
+//// Во время работы выключена, пока не вызван stats_enable: таймер тогда не читает часы,
+//// а счётчики команд копятся в локальном массиве и никуда не сливаются.
+#ifndef DISASM_STATS
+#define DISASM_STATS 1
+#endif
+
+enum class Stats_Phase : uint8_t {
+    OPEN, HEADER, SECTIONS, SYMTABLE, CFG, TEXT, SYMTAB, OUTPUT, COUNT
+};
+
+enum class Stats_Counter : uint8_t {
+    FORMAT_R, FORMAT_I, FORMAT_S, FORMAT_B, FORMAT_U, FORMAT_J, CSR, ATOMIC, FLOAT, RVC, UNKNOWN,
+    CACHED, TEXT_BYTES, BYTES_READ, BYTES_WRITTEN, ALLOCATIONS, ALLOCATED_BYTES, FILES, COUNT
+};
+
+enum class Stats_Format {
+    TABLE, JSON
+};
+
+#if DISASM_STATS
+
+void stats_enable(bool enable);
+bool stats_enabled();
+void stats_add(Stats_Counter counter, uint64_t value);
+void stats_add_time(Stats_Phase phase, uint64_t nanoseconds);
+//// seconds - полное время работы, по нему считаются MB/s и команды/с.
+void write_stats(std::ostream& output, Stats_Format format, double seconds);
+
+//// Время от создания до разрушения добавляется к этапу.
+class Phase_Timer {
+public:
+    explicit Phase_Timer(Stats_Phase phase):
+            _phase(phase),
+            _enabled(stats_enabled()) {
+        if (_enabled) _start = std::chrono::steady_clock::now();
+    }
+    ~Phase_Timer() {
+        if (!_enabled) return;
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        stats_add_time(_phase, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    Phase_Timer(const Phase_Timer&) = delete;
+    Phase_Timer& operator=(const Phase_Timer&) = delete;
+
+private:
+    Stats_Phase _phase;
+    bool _enabled;
+    std::chrono::steady_clock::time_point _start;
+};
+
+//// Счётчики команд по форматам для одного куска .text, сливаются в общие при разрушении.
+class Instruction_Stats {
+public:
+    Instruction_Stats():
+            _enabled(stats_enabled()) {}
+    ~Instruction_Stats();
+    Instruction_Stats(const Instruction_Stats&) = delete;
+    Instruction_Stats& operator=(const Instruction_Stats&) = delete;
+
+    void count(const Instruction& inst) {
+        if (!_enabled) return;
+        _counts[inst.mnemonic == Mnemonic::UNKNOWN ? (size_t) Stats_Counter::UNKNOWN :
+                inst.length == 2 ? (size_t) Stats_Counter::RVC : FORMAT_COUNTERS[(size_t) inst.format]]++;
+    }
+
+private:
+    static constexpr uint8_t FORMAT_COUNTERS[] = {
+            (uint8_t) Stats_Counter::FORMAT_I,  // NONE: fence, ecall, ebreak
+            (uint8_t) Stats_Counter::FORMAT_R,
+            (uint8_t) Stats_Counter::FORMAT_I,
+            (uint8_t) Stats_Counter::FORMAT_I,  // LOAD
+            (uint8_t) Stats_Counter::FORMAT_I,  // SHIFT
+            (uint8_t) Stats_Counter::FORMAT_S,
+            (uint8_t) Stats_Counter::FORMAT_B,
+            (uint8_t) Stats_Counter::FORMAT_U,
+            (uint8_t) Stats_Counter::FORMAT_J,
+            (uint8_t) Stats_Counter::FORMAT_I,  // UNARY: clz, rev8, ...
+            (uint8_t) Stats_Counter::CSR,  // CSR
+            (uint8_t) Stats_Counter::CSR,  // CSR_IMM
+            (uint8_t) Stats_Counter::ATOMIC,  // LR
+            (uint8_t) Stats_Counter::ATOMIC,  // AMO
+            (uint8_t) Stats_Counter::FLOAT,  // F_LOAD
+            (uint8_t) Stats_Counter::FLOAT,  // F_STORE
+            (uint8_t) Stats_Counter::FLOAT,  // F_FFF
+            (uint8_t) Stats_Counter::FLOAT,  // F_FFF_RM
+            (uint8_t) Stats_Counter::FLOAT,  // F_FFFF_RM (R4)
+            (uint8_t) Stats_Counter::FLOAT,  // F_FF
+            (uint8_t) Stats_Counter::FLOAT,  // F_FF_RM
+            (uint8_t) Stats_Counter::FLOAT,  // F_XF
+            (uint8_t) Stats_Counter::FLOAT,  // F_XF_RM
+            (uint8_t) Stats_Counter::FLOAT,  // F_FX
+            (uint8_t) Stats_Counter::FLOAT,  // F_FX_RM
+            (uint8_t) Stats_Counter::FLOAT,  // F_XFF
+    };
+    static_assert(sizeof(FORMAT_COUNTERS) == (size_t) Format::COUNT, "FORMAT_COUNTERS covers every Format");
+
+    bool _enabled;
+    uint64_t _counts[(size_t) Stats_Counter::UNKNOWN + 1] = {};
+};
+
+#else
+
+inline void stats_enable(bool) {}
+inline bool stats_enabled() { return false; }
+inline void stats_add(Stats_Counter, uint64_t) {}
+inline void stats_add_time(Stats_Phase, uint64_t) {}
+inline void write_stats(std::ostream&, Stats_Format, double) {}
+
+class Phase_Timer {
+public:
+    explicit Phase_Timer(Stats_Phase) {}
+};
+
+class Instruction_Stats {
+public:
+    void count(const Instruction&) {}
+};
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+
+//// Реализация предварительного прохода; BEST выбирается по процессору при запуске.
+enum class Scan_Isa {
+    BEST, SCALAR, SSE2, AVX2
+};
+
+bool scan_isa_supported(Scan_Isa isa);
+std::string_view scan_isa_name(Scan_Isa isa);
+
+//// Начала команд для halfwords полуслов с text: бит i в starts - команда с text + 2 * i.
+//// carry - начинается ли команда с первого полуслова; возвращается то же для полуслова
+//// сразу за блоком, так что длинный текст можно обходить блоками.
+bool scan_instruction_starts(const uint8_t* text, size_t halfwords, bool carry, uint64_t* starts,
+                             Scan_Isa isa = Scan_Isa::BEST);
+
+const size_t SCAN_BLOCK_WORDS = 1024;
+
+//// Проход вперёд по началам команд блоками по SCAN_BLOCK_WORDS слов карты,
+//// без карты на весь текст. Запросы должны идти по неубывающим смещениям.
+class Start_Cursor {
+public:
+    Start_Cursor(const uint8_t* text, size_t size, Scan_Isa isa = Scan_Isa::BEST);
+    //// Первое начало команды со смещением не меньше offset, либо size, если его нет.
+    size_t next(size_t offset);
+
+private:
+    bool load_block();
+
+    const uint8_t* _text;
+    size_t _size;
+    Scan_Isa _isa;
+    size_t _block_begin = 0;
+    size_t _block_end = 0;
+    bool _carry = true;
+    std::vector<uint64_t> _starts;
+};
+
+//// Разреженный индекс точек синхронизации: заведомые начала команд (начало секции, функции).
+//// Чтобы начать разбор с середины секции, границы команд ищутся проходом по младшим битам
+//// только от ближайшей предшествующей точки, а не от начала секции.
+class Sync_Index {
+public:
+    explicit Sync_Index(size_t size);
+    void add(size_t offset);
+    void build();
+    //// Ближайшая точка не дальше offset.
+    size_t before(size_t offset) const;
+    //// Первое начало команды со смещением не меньше offset, либо size, если его нет.
+    size_t next_start(const uint8_t* text, size_t offset) const;
+
+private:
+    size_t _size;
+    std::vector<size_t> _points = {0};
+};
+
+//// Битовая карта начал команд всего .text (по биту на полуслово) и гистограмма опкодов.
+class Text_Scan {
+public:
+    Text_Scan(const uint8_t* text, size_t size, Scan_Isa isa = Scan_Isa::BEST);
+
+    size_t size() const;
+    bool is_start(size_t offset) const;
+    //// Первое начало команды со смещением не меньше offset, либо size(), если его нет.
+    size_t next_start(size_t offset) const;
+    const std::vector<uint64_t>& starts() const;
+
+    //// Число 32-битных команд по старшему опкоду (биты 6:0) и сжатых по квадранту (биты 1:0).
+    void count_opcodes(uint64_t opcodes[128], uint64_t compressed[3]) const;
+
+private:
+    const uint8_t* _text;
+    size_t _size;
+    std::vector<uint64_t> _starts;
+};
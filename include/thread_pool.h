@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//// Пул с захватом работы: у каждого потока своя очередь, задачи, поставленные
+//// из потока пула, попадают в его очередь, свободные потоки забирают чужие.
+//// Ожидание результата из потока пула (wait) не блокирует его, а выполняет другие задачи,
+//// поэтому задача может сама делиться на подзадачи и дожидаться их.
+class Thread_Pool {
+public:
+    explicit Thread_Pool(size_t threads);
+    ~Thread_Pool();
+    Thread_Pool(const Thread_Pool&) = delete;
+    Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+    size_t size() const;
+    std::future<void> submit(std::function<void()> task);
+    void wait(std::future<void>& future);
+
+private:
+    struct Worker_Queue {
+        std::mutex mutex;
+        std::deque<std::packaged_task<void()>> tasks;
+    };
+
+    void worker(size_t index);
+    bool try_run_one(size_t index);
+
+    std::vector<std::thread> _threads;
+    std::vector<std::unique_ptr<Worker_Queue>> _queues;
+    Worker_Queue _global;
+    std::atomic<size_t> _pending{0};
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    //// Потоки пула внутри wait(): будятся при новой задаче и по завершении любой.
+    std::condition_variable _done_cv;
+    size_t _waiting = 0;
+    bool _stop = false;
+};
+
+//// task(0) ... task(count - 1) в пуле и ожидание всех; без пула (или с одним потоком) - по
+//// порядку в вызывающем потоке. Первое исключение задачи пробрасывается после того, как
+//// дождались всех поставленных задач: они ссылаются на task и данные вызывающего.
+template<typename Task>
+void parallel_for(Thread_Pool* pool, size_t count, Task&& task) {
+    if (!pool || pool->size() < 2 || count < 2) {
+        for (size_t i = 0; i < count; i++) task(i);
+        return;
+    }
+    std::vector<std::future<void>> futures;
+    futures.reserve(count);
+    try {
+        for (size_t i = 0; i < count; i++) futures.push_back(pool->submit([&task, i] { task(i); }));
+        for (std::future<void>& future : futures) {
+            pool->wait(future);
+            future.get();
+        }
+    }
+    catch (...) {
+        for (std::future<void>& future : futures) {
+            if (future.valid()) pool->wait(future);
+        }
+        throw;
+    }
+}
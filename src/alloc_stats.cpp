@@ -0,0 +1,35 @@
+#include "stats.h"
+
+#if DISASM_STATS
+#include <cstdlib>
+#include <new>
+
+
+//// Подсчёт выделений памяти для --stats: заменяет глобальные operator new/delete
+//// только в самой программе, библиотека disasm их не трогает.
+void* operator new(std::size_t size) {
+    stats_add(Stats_Counter::ALLOCATIONS, 1);
+    stats_add(Stats_Counter::ALLOCATED_BYTES, size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    stats_add(Stats_Counter::ALLOCATIONS, 1);
+    stats_add(Stats_Counter::ALLOCATED_BYTES, size);
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#endif
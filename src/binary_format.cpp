@@ -0,0 +1,126 @@
+#include "binary_format.h"
+#include "disassembler.h"
+#include "elf_parser.h"
+#include "instruction_iterator.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+const size_t BINARY_WRITE_BATCH = 1 << 16;
+
+size_t write_binary_listing(std::ostream& output, const uint8_t* text, size_t size, uint64_t address,
+                            const Label_Index& labels, Xlen xlen) {
+    //// Первый проход только считает команды, чтобы заголовок был известен сразу
+    //// и файл писался строго последовательно (в том числе в канал).
+    size_t count = 0;
+    for (size_t pos = 0; size - pos >= SMALL_INST_SIZE; count++) {
+        size_t length = (text[pos] & 0b11) == 0b11 ? BIG_INST_SIZE : SMALL_INST_SIZE;
+        if (size - pos < length) break;
+        pos += length;
+    }
+
+    std::string_view strings = labels.names();
+    Binary_Header header{};
+    std::copy(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC), header.magic);
+    header.version = BINARY_VERSION;
+    header.header_size = sizeof(Binary_Header);
+    header.record_size = sizeof(Binary_Record);
+    header.record_count = count;
+    header.strings_offset = sizeof(Binary_Header);
+    header.strings_size = strings.size();
+    header.records_offset = (header.strings_offset + header.strings_size + 7) & ~7ull;
+    header.text_address = address;
+
+    output.write((const char*) &header, sizeof(header));
+    output.write(strings.data(), strings.size());
+    output.write("\0\0\0\0\0\0\0", header.records_offset - header.strings_offset - header.strings_size);
+
+    std::vector<Binary_Record> batch;
+    batch.reserve(BINARY_WRITE_BATCH);
+    Label_Index::Cursor label(labels, address);
+    Instruction_Stats stats;
+    for (const Instruction& inst : Instruction_Range(text, size, address, xlen)) {
+        stats.count(inst);
+        Binary_Record record{};
+        record.address = inst.address;
+        record.raw = inst.raw;
+        record.imm = inst.imm;
+        std::string_view name = label.at(inst.address);
+        record.label_offset = name.empty() ? NO_LABEL : (uint32_t) (name.data() - strings.data());
+        record.label_size = name.size();
+        record.mnemonic = (uint16_t) inst.mnemonic;
+        record.length = inst.length;
+        record.format = (uint8_t) inst.format;
+        record.rd = inst.rd;
+        record.rs1 = inst.rs1;
+        record.rs2 = inst.rs2;
+        record.rs3 = inst.rs3;
+        batch.push_back(record);
+        if (batch.size() == BINARY_WRITE_BATCH) {
+            output.write((const char*) batch.data(), batch.size() * sizeof(Binary_Record));
+            batch.clear();
+        }
+    }
+    output.write((const char*) batch.data(), batch.size() * sizeof(Binary_Record));
+    stats_add(Stats_Counter::BYTES_WRITTEN, header.records_offset + count * sizeof(Binary_Record));
+    return count;
+}
+
+
+Binary_Listing::Binary_Listing(const std::string& filename):
+        _file(filename) {
+    if (_file.size() < sizeof(Binary_Header))
+        throw DisassemblerException("Incorrect file format! Size of the listing header is too small.");
+    _header = _file.read<Binary_Header>(0);
+    if (!std::equal(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC), _header.magic))
+        throw DisassemblerException("Incorrect file format! Not a binary listing.");
+    if (_header.version != BINARY_VERSION || _header.record_size != sizeof(Binary_Record))
+        throw DisassemblerException("Unsupported binary listing version!");
+    if (_header.records_offset > _file.size() ||
+        _header.record_count > (_file.size() - _header.records_offset) / sizeof(Binary_Record))
+        throw DisassemblerException("Incorrect file format! Records are out of the file bounds.");
+    _strings = std::string_view((const char*) _file.data(_header.strings_offset, _header.strings_size),
+                                _header.strings_size);
+    _records = _file.data(_header.records_offset, _header.record_count * sizeof(Binary_Record));
+}
+
+size_t Binary_Listing::size() const {
+    return _header.record_count;
+}
+
+Binary_Record Binary_Listing::record(size_t i) const {
+    Binary_Record record;
+    std::memcpy(&record, _records + i * sizeof(Binary_Record), sizeof(Binary_Record));
+    return record;
+}
+
+Instruction Binary_Listing::instruction(size_t i) const {
+    Binary_Record r = record(i);
+    Instruction inst{};
+    inst.address = r.address;
+    inst.raw = r.raw;
+    inst.mnemonic = r.mnemonic < (uint16_t) Mnemonic::COUNT ? (Mnemonic) r.mnemonic : Mnemonic::UNKNOWN;
+    inst.format = inst.mnemonic == Mnemonic::UNKNOWN || r.format >= (uint8_t) Format::COUNT ? Format::NONE :
+                  (Format) r.format;
+    inst.length = r.length;
+    inst.rd = r.rd & 0x1f;
+    inst.rs1 = r.rs1 & 0x1f;
+    inst.rs2 = r.rs2 & 0x1f;
+    inst.rs3 = r.rs3 & 0x1f;
+    inst.imm = r.imm;
+    return inst;
+}
+
+std::string_view Binary_Listing::label(size_t i) const {
+    Binary_Record r = record(i);
+    if (r.label_offset == NO_LABEL || r.label_offset > _strings.size()) return {};
+    return _strings.substr(r.label_offset, r.label_size);
+}
+
+void Binary_Listing::write_text(Output_Buffer& output) const {
+    output.append(".text\n");
+    for (size_t i = 0; i < size(); i++) write_instruction_line(output, instruction(i), label(i));
+    output.put('\n');
+}
@@ -0,0 +1,537 @@
+#include "cfg.h"
+#include "instruction_iterator.h"
+#include "text_scan.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+
+
+const uint32_t CFG_CHUNK_SIZE = 1 << 18;
+const uint32_t NO_CONTROL = UINT32_MAX;
+
+static inline unsigned popcount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    unsigned n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+#endif
+}
+
+static inline unsigned lowest_bit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    unsigned n = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline bool is_branch(Mnemonic mnemonic) {
+    return mnemonic >= Mnemonic::BEQ && mnemonic <= Mnemonic::BGEU;
+}
+
+//// Битовая карта по полусловам с префиксными суммами: rank(i) - число единиц до i за O(1).
+class Rank_Bitmap {
+public:
+    void reset(size_t bits) {
+        _words.assign((bits + 63) / 64 + 1, 0);
+    }
+    void set(size_t i) { _words[i / 64] |= 1ull << (i % 64); }
+    bool test(size_t i) const { return _words[i / 64] >> (i % 64) & 1; }
+    void intersect(const Rank_Bitmap& other) {
+        for (size_t w = 0; w < _words.size(); w++) _words[w] &= other._words[w];
+    }
+    void build_rank() {
+        _rank.resize(_words.size());
+        uint32_t total = 0;
+        for (size_t w = 0; w < _words.size(); w++) {
+            _rank[w] = total;
+            total += popcount(_words[w]);
+        }
+    }
+    uint32_t rank(size_t i) const {
+        uint64_t below = i % 64 == 0 ? 0 : _words[i / 64] << (64 - i % 64);
+        return _rank[i / 64] + popcount(below);
+    }
+    const std::vector<uint64_t>& words() const { return _words; }
+
+private:
+    std::vector<uint64_t> _words;
+    std::vector<uint32_t> _rank;
+};
+
+//// Разбор функций одной задачи. Карты и списки переиспользуются между функциями,
+//// номера блоков в результате - внутри части, при сборке графа к ним прибавляется сдвиг.
+class Function_Analyzer {
+public:
+    Function_Analyzer(const uint8_t* text, uint64_t address, Xlen xlen):
+            _text(text),
+            _address(address),
+            _xlen(xlen) {}
+
+    void analyze(uint32_t begin, uint32_t end, Control_Flow_Graph& part);
+
+private:
+    uint32_t target_block(uint64_t target, uint32_t begin, uint32_t end, uint32_t base) const;
+
+    const uint8_t* _text;
+    uint64_t _address;
+    Xlen _xlen;
+    Rank_Bitmap _starts;
+    Rank_Bitmap _leaders;
+    std::vector<Instruction> _controls;
+    std::vector<uint32_t> _terminators;
+    std::vector<uint32_t> _block_begins;
+};
+
+uint32_t Function_Analyzer::target_block(uint64_t target, uint32_t begin, uint32_t end, uint32_t base) const {
+    uint64_t function = _address + begin;
+    if (target < function || target >= _address + end || (target - function) % 2 != 0) return NO_BLOCK;
+    size_t halfword = (target - function) / 2;
+    if (!_leaders.test(halfword)) return NO_BLOCK;
+    return base + _leaders.rank(halfword);
+}
+
+void Function_Analyzer::analyze(uint32_t begin, uint32_t end, Control_Flow_Graph& part) {
+    uint32_t size = end - begin;
+    size_t halfwords = (size + 1) / 2;
+    uint64_t function = _address + begin;
+    _starts.reset(halfwords);
+    _leaders.reset(halfwords);
+    _controls.clear();
+    _leaders.set(0);
+
+    //// Первый проход: начала команд, переходы и начала блоков (цели и команды после переходов).
+    auto mark = [this, function, size](uint64_t target) {
+        if (target >= function && target < function + size && (target - function) % 2 == 0)
+            _leaders.set((target - function) / 2);
+    };
+    for (Instruction_Iterator it(_text, end, begin, _address, _xlen); it != Instruction_Iterator(); ++it) {
+        _starts.set((it.offset() - begin) / 2);
+        const Instruction& inst = *it;
+        uint64_t next = inst.address + inst.length;
+        if (is_branch(inst.mnemonic)) {
+            mark(inst.address + inst.imm);
+            mark(next);
+        }
+        else if (inst.mnemonic == Mnemonic::JAL) {
+            if (inst.rd == 0) {
+                mark(inst.address + inst.imm);
+                mark(next);
+            }
+        }
+        else if (inst.mnemonic == Mnemonic::JALR) {
+            if (inst.rd == 0) mark(next);
+        }
+        else {
+            continue;
+        }
+        _controls.push_back(inst);
+    }
+    //// Цель посреди команды началом блока не считается.
+    _leaders.intersect(_starts);
+    _starts.build_rank();
+    _leaders.build_rank();
+
+    _block_begins.clear();
+    const std::vector<uint64_t>& words = _leaders.words();
+    for (size_t w = 0; w < words.size(); w++) {
+        for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+            _block_begins.push_back((w * 64 + lowest_bit(bits)) * 2);
+        }
+    }
+    uint32_t base = part.blocks.size();
+    uint32_t count = _block_begins.size();
+    part.functions.push_back(Cfg_Function{function, size, base, count});
+    if (count == 0) return;
+
+    //// Второй проход - только по переходам: команда перехода последняя в своём блоке.
+    _terminators.assign(count, NO_CONTROL);
+    for (uint32_t i = 0; i < _controls.size(); i++) {
+        const Instruction& inst = _controls[i];
+        size_t halfword = (inst.address - function) / 2;
+        uint32_t block = _leaders.rank(halfword + 1) - 1;
+        if (inst.mnemonic == Mnemonic::JAL && inst.rd != 0) {
+            part.calls.push_back(Cfg_Call{inst.address + inst.imm, base + block, NO_BLOCK});
+        }
+        else if (inst.mnemonic != Mnemonic::JALR || inst.rd == 0) {
+            _terminators[block] = i;
+        }
+    }
+
+    for (uint32_t b = 0; b < count; b++) {
+        uint32_t block_begin = _block_begins[b];
+        uint32_t block_end = b + 1 < count ? _block_begins[b + 1] : size;
+        Basic_Block block{function + block_begin, block_end - block_begin,
+                          _starts.rank((block_end + 1) / 2) - _starts.rank(block_begin / 2),
+                          (uint32_t) part.edges.size(), 0, Block_End::FALLTHROUGH};
+        uint64_t next = function + block_end;
+        uint32_t next_block = b + 1 < count ? base + b + 1 : NO_BLOCK;
+        if (_terminators[b] == NO_CONTROL) {
+            part.edges.push_back(Cfg_Edge{next, next_block, Edge_Kind::FALLTHROUGH});
+        }
+        else {
+            const Instruction& inst = _controls[_terminators[b]];
+            uint64_t target = inst.address + inst.imm;
+            if (is_branch(inst.mnemonic)) {
+                block.end = Block_End::BRANCH;
+                part.edges.push_back(Cfg_Edge{target, target_block(target, begin, end, base), Edge_Kind::TAKEN});
+                part.edges.push_back(Cfg_Edge{next, next_block, Edge_Kind::FALLTHROUGH});
+            }
+            else if (inst.mnemonic == Mnemonic::JAL) {
+                block.end = Block_End::JUMP;
+                part.edges.push_back(Cfg_Edge{target, target_block(target, begin, end, base), Edge_Kind::JUMP});
+            }
+            else {
+                block.end = inst.rs1 == 1 && inst.imm == 0 ? Block_End::RETURN : Block_End::INDIRECT;
+            }
+        }
+        block.edge_count = part.edges.size() - block.first_edge;
+        part.blocks.push_back(block);
+    }
+}
+
+
+uint32_t Control_Flow_Graph::function_at(uint64_t address) const {
+    auto it = std::lower_bound(functions.begin(), functions.end(), address,
+                               [](const Cfg_Function& function, uint64_t value) {
+                                   return function.address < value;
+                               });
+    if (it == functions.end() || it->address != address) return NO_BLOCK;
+    return it - functions.begin();
+}
+
+std::vector<uint64_t> Control_Flow_Graph::targets() const {
+    std::vector<bool> target(blocks.size());
+    for (const Cfg_Function& function : functions) {
+        if (function.block_count != 0) target[function.first_block] = true;
+    }
+    for (const Cfg_Edge& edge : edges) {
+        if (edge.kind != Edge_Kind::FALLTHROUGH && edge.block != NO_BLOCK) target[edge.block] = true;
+    }
+    std::vector<uint64_t> addresses;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (target[i]) addresses.push_back(blocks[i].address);
+    }
+    return addresses;
+}
+
+
+//// Цели jal с rd != zero в [begin, end) - смещения от начала секции. Декодируются только
+//// jal и c.jal (есть лишь в RV32), остальные команды пропускаются по длине.
+static void find_calls(const uint8_t* text, uint32_t size, uint32_t begin, uint32_t end, uint64_t address,
+                       Xlen xlen, std::vector<uint32_t>& targets) {
+    uint32_t pos = begin;
+    while (end - pos >= 2) {
+        uint16_t low;
+        std::memcpy(&low, text + pos, sizeof(low));
+        Instruction inst;
+        if (instruction_length(low) == 4) {
+            if (end - pos < 4) break;
+            uint32_t raw;
+            std::memcpy(&raw, text + pos, sizeof(raw));
+            pos += 4;
+            if ((raw & 0x7f) != 0b1101111 || (raw & 0xf80) == 0) continue;
+            inst = decode_instruction(raw, address + pos - 4, xlen);
+        }
+        else {
+            pos += 2;
+            if (xlen != Xlen::RV32 || (low & 0xe003) != 0x2001) continue;
+            inst = decode_compressed(low, address + pos - 2, xlen);
+        }
+        uint64_t target = inst.address + inst.imm;
+        if (target >= address && target < address + size && (target - address) % 2 == 0)
+            targets.push_back(target - address);
+    }
+}
+
+//// Куски по CFG_CHUNK_SIZE, разрезанные по началам команд.
+static std::vector<uint32_t> split_chunks(const uint8_t* text, uint32_t size) {
+    std::vector<uint32_t> bounds = {0};
+    Start_Cursor starts(text, size);
+    for (uint32_t pos = starts.next(CFG_CHUNK_SIZE); pos < size; pos = starts.next(pos + CFG_CHUNK_SIZE)) {
+        bounds.push_back(pos);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+Control_Flow_Graph build_control_flow(const uint8_t* text, uint32_t size, uint64_t address, Xlen xlen,
+                                      std::vector<uint32_t> entries, Thread_Pool* pool) {
+    Control_Flow_Graph cfg;
+    if (size < 2) return cfg;
+
+    //// Начала функций: вызовы ищутся по кускам параллельно, объединяются битовой картой.
+    std::vector<uint32_t> chunks = split_chunks(text, size);
+    std::vector<std::vector<uint32_t>> calls(chunks.size() - 1);
+    parallel_for(pool, calls.size(), [&](size_t i) {
+        find_calls(text, size, chunks[i], chunks[i + 1], address, xlen, calls[i]);
+    });
+    Rank_Bitmap starts;
+    starts.reset(size / 2);
+    starts.set(0);
+    for (uint32_t entry : entries) {
+        if (entry < size && entry % 2 == 0) starts.set(entry / 2);
+    }
+    for (const std::vector<uint32_t>& targets : calls) {
+        for (uint32_t target : targets) starts.set(target / 2);
+    }
+    starts.build_rank();
+    std::vector<uint32_t> functions;
+    const std::vector<uint64_t>& words = starts.words();
+    for (size_t w = 0; w < words.size(); w++) {
+        for (uint64_t bits = words[w]; bits; bits &= bits - 1) functions.push_back((w * 64 + lowest_bit(bits)) * 2);
+    }
+    functions.push_back(size);
+
+    //// Задачи из подряд идущих функций общим размером от CFG_CHUNK_SIZE.
+    std::vector<size_t> groups = {0};
+    for (size_t f = 1; f + 1 < functions.size(); f++) {
+        if (functions[f] - functions[groups.back()] >= CFG_CHUNK_SIZE) groups.push_back(f);
+    }
+    groups.push_back(functions.size() - 1);
+
+    std::vector<Control_Flow_Graph> parts(groups.size() - 1);
+    parallel_for(pool, parts.size(), [&](size_t i) {
+        Function_Analyzer analyzer(text, address, xlen);
+        for (size_t f = groups[i]; f < groups[i + 1]; f++) analyzer.analyze(functions[f], functions[f + 1], parts[i]);
+    });
+
+    size_t function_count = 0, block_count = 0, edge_count = 0, call_count = 0;
+    for (const Control_Flow_Graph& part : parts) {
+        function_count += part.functions.size();
+        block_count += part.blocks.size();
+        edge_count += part.edges.size();
+        call_count += part.calls.size();
+    }
+    cfg.functions.reserve(function_count);
+    cfg.blocks.reserve(block_count);
+    cfg.edges.reserve(edge_count);
+    cfg.calls.reserve(call_count);
+    for (Control_Flow_Graph& part : parts) {
+        uint32_t block_base = cfg.blocks.size();
+        uint32_t edge_base = cfg.edges.size();
+        for (Cfg_Function function : part.functions) {
+            function.first_block += block_base;
+            cfg.functions.push_back(function);
+        }
+        for (Basic_Block block : part.blocks) {
+            block.first_edge += edge_base;
+            cfg.blocks.push_back(block);
+        }
+        for (Cfg_Edge edge : part.edges) {
+            if (edge.block != NO_BLOCK) edge.block += block_base;
+            cfg.edges.push_back(edge);
+        }
+        for (Cfg_Call call : part.calls) {
+            call.block += block_base;
+            cfg.calls.push_back(call);
+        }
+        part = Control_Flow_Graph();
+    }
+
+    //// Переходы за пределы функции на начало другой (хвостовые вызовы, проваливание в следующую).
+    //// Номер функции - ранг её начала в карте: функции идут в том же порядке.
+    auto function_at = [&starts, address, size](uint64_t target) {
+        if (target < address || target >= address + size || (target - address) % 2 != 0) return NO_BLOCK;
+        size_t halfword = (target - address) / 2;
+        return starts.test(halfword) ? starts.rank(halfword) : NO_BLOCK;
+    };
+    for (Cfg_Edge& edge : cfg.edges) {
+        if (edge.block != NO_BLOCK) continue;
+        uint32_t function = function_at(edge.target);
+        if (function != NO_BLOCK && cfg.functions[function].block_count != 0)
+            edge.block = cfg.functions[function].first_block;
+    }
+    for (Cfg_Call& call : cfg.calls) call.function = function_at(call.target);
+    return cfg;
+}
+
+
+std::string_view synthetic_label(uint64_t address, char* buffer) {
+    int length = std::snprintf(buffer, 19, "L_%08llx", (unsigned long long) address);
+    return std::string_view(buffer, length);
+}
+
+static std::string_view block_name(const Label_Index& labels, uint64_t address, char* buffer) {
+    std::string_view name = labels.find(address);
+    return name.empty() ? synthetic_label(address, buffer) : name;
+}
+
+static void append_escaped(Output_Buffer& output, std::string_view str) {
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            output.put('\\');
+            output.put(c);
+        }
+        else if ((unsigned char) c < 0x20) {
+            output.append("\\u00");
+            output.append_hex((unsigned char) c, 2);
+        }
+        else {
+            output.put(c);
+        }
+    }
+}
+
+static void append_address(Output_Buffer& output, uint64_t address) {
+    output.append("\"0x");
+    output.append_hex(address, 8);
+    output.put('"');
+}
+
+static const std::string_view BLOCK_ENDS[] = {"fallthrough", "branch", "jump", "indirect", "return"};
+static const std::string_view EDGE_KINDS[] = {"fallthrough", "taken", "jump"};
+
+static void write_dot_node(Output_Buffer& output, uint32_t section_index, uint32_t block) {
+    output.put('s');
+    output.append_udec(section_index);
+    output.append("_b");
+    output.append_udec(block);
+}
+
+static void write_dot_section(Output_Buffer& output, const Control_Flow_Graph& cfg, const Label_Index& labels,
+                              uint32_t section_index) {
+    char buffer[20];
+    for (size_t f = 0; f < cfg.functions.size(); f++) {
+        const Cfg_Function& function = cfg.functions[f];
+        output.append("    subgraph cluster_s");
+        output.append_udec(section_index);
+        output.append("_f");
+        output.append_udec(f);
+        output.append(" {\n        label=\"");
+        append_escaped(output, block_name(labels, function.address, buffer));
+        output.append("\";\n");
+        for (uint32_t b = function.first_block; b < function.first_block + function.block_count; b++) {
+            const Basic_Block& block = cfg.blocks[b];
+            output.append("        ");
+            write_dot_node(output, section_index, b);
+            output.append(" [label=\"");
+            append_escaped(output, block_name(labels, block.address, buffer));
+            output.append("\\n");
+            output.append_udec(block.instructions);
+            output.append(" instr, ");
+            output.append(BLOCK_ENDS[(size_t) block.end]);
+            output.append("\"];\n");
+        }
+        output.append("    }\n");
+    }
+    for (size_t b = 0; b < cfg.blocks.size(); b++) {
+        const Basic_Block& block = cfg.blocks[b];
+        for (uint32_t e = block.first_edge; e < block.first_edge + block.edge_count; e++) {
+            const Cfg_Edge& edge = cfg.edges[e];
+            if (edge.block == NO_BLOCK) continue;
+            output.append("    ");
+            write_dot_node(output, section_index, b);
+            output.append(" -> ");
+            write_dot_node(output, section_index, edge.block);
+            output.append(" [label=\"");
+            output.append(EDGE_KINDS[(size_t) edge.kind]);
+            output.append("\"];\n");
+        }
+    }
+    for (const Cfg_Call& call : cfg.calls) {
+        if (call.function == NO_BLOCK || cfg.functions[call.function].block_count == 0) continue;
+        output.append("    ");
+        write_dot_node(output, section_index, call.block);
+        output.append(" -> ");
+        write_dot_node(output, section_index, cfg.functions[call.function].first_block);
+        output.append(" [style=dashed, label=\"call\"];\n");
+    }
+}
+
+static void write_json_section(Output_Buffer& output, const Control_Flow_Graph& cfg, const Label_Index& labels,
+                               std::string_view section, uint32_t section_index) {
+    char buffer[20];
+    output.append("{\"name\": \"");
+    append_escaped(output, section);
+    output.append("\", \"index\": ");
+    output.append_udec(section_index);
+    output.append(", \"functions\": [");
+    size_t call = 0;
+    for (size_t f = 0; f < cfg.functions.size(); f++) {
+        const Cfg_Function& function = cfg.functions[f];
+        output.append(f == 0 ? "\n" : ",\n");
+        output.append("  {\"name\": \"");
+        append_escaped(output, block_name(labels, function.address, buffer));
+        output.append("\", \"address\": ");
+        append_address(output, function.address);
+        output.append(", \"size\": ");
+        output.append_udec(function.size);
+        output.append(", \"blocks\": [");
+        for (uint32_t b = function.first_block; b < function.first_block + function.block_count; b++) {
+            const Basic_Block& block = cfg.blocks[b];
+            output.append(b == function.first_block ? "\n" : ",\n");
+            output.append("    {\"id\": ");
+            output.append_udec(b);
+            output.append(", \"address\": ");
+            append_address(output, block.address);
+            output.append(", \"size\": ");
+            output.append_udec(block.size);
+            output.append(", \"instructions\": ");
+            output.append_udec(block.instructions);
+            output.append(", \"end\": \"");
+            output.append(BLOCK_ENDS[(size_t) block.end]);
+            output.append("\", \"successors\": [");
+            for (uint32_t e = block.first_edge; e < block.first_edge + block.edge_count; e++) {
+                const Cfg_Edge& edge = cfg.edges[e];
+                if (e != block.first_edge) output.append(", ");
+                output.append("{\"kind\": \"");
+                output.append(EDGE_KINDS[(size_t) edge.kind]);
+                output.append("\", \"address\": ");
+                append_address(output, edge.target);
+                output.append(", \"block\": ");
+                if (edge.block == NO_BLOCK) output.append("null");
+                else output.append_udec(edge.block);
+                output.put('}');
+            }
+            output.append("], \"calls\": [");
+            for (bool first = true; call < cfg.calls.size() && cfg.calls[call].block == b; call++, first = false) {
+                if (!first) output.append(", ");
+                output.append("{\"address\": ");
+                append_address(output, cfg.calls[call].target);
+                output.append(", \"function\": ");
+                if (cfg.calls[call].function == NO_BLOCK) {
+                    output.append("null");
+                }
+                else {
+                    output.put('"');
+                    append_escaped(output, block_name(labels, cfg.calls[call].target, buffer));
+                    output.put('"');
+                }
+                output.put('}');
+            }
+            output.append("]}");
+        }
+        output.append("]}");
+    }
+    output.append("\n]}");
+}
+
+void write_cfg_begin(Output_Buffer& output, Cfg_Format format) {
+    if (format == Cfg_Format::DOT) output.append("digraph cfg {\n    node [shape=box, fontname=\"monospace\"];\n");
+    else output.append("{\"sections\": [\n");
+}
+
+void write_cfg_section(Output_Buffer& output, Cfg_Format format, const Control_Flow_Graph& cfg,
+                       const Label_Index& labels, std::string_view section, uint32_t section_index, bool first) {
+    if (format == Cfg_Format::DOT) {
+        write_dot_section(output, cfg, labels, section_index);
+        return;
+    }
+    if (!first) output.append(",\n");
+    write_json_section(output, cfg, labels, section, section_index);
+}
+
+void write_cfg_end(Output_Buffer& output, Cfg_Format format) {
+    if (format == Cfg_Format::DOT) output.append("}\n");
+    else output.append("\n]}\n");
+}
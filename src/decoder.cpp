@@ -0,0 +1,679 @@
+#include "decoder.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+enum Node_Kind : uint8_t {
+    LEAF, BY_FUNCT7, BY_RS2
+};
+
+struct Decode_Node {
+    Node_Kind kind = LEAF;
+    Format format = Format::NONE;
+    uint16_t value = 0;  //// мнемоника для листа, начало дочернего блока иначе
+};
+
+const int ANY = -1;
+//// funct3 - режим округления: подходят все, кроме зарезервированных 5 и 6.
+const int RM = -2;
+const size_t ROOT_SIZE = 32 * 8;  //// opcode[6:2] x funct3
+const size_t POOL_SIZE = 12288;
+
+struct Decode_Tables {
+    std::array<Decode_Node, POOL_SIZE> nodes{};
+    size_t used = ROOT_SIZE;
+
+    constexpr uint16_t alloc(size_t count, Decode_Node fill) {
+        size_t start = used;
+        for (size_t i = 0; i < count; i++) nodes[start + i] = fill;
+        used += count;
+        return (uint16_t) start;
+    }
+
+    constexpr void add(uint32_t opcode, int funct3, int funct7, int rs2, Mnemonic mnemonic, Format format,
+                       uint32_t funct7_mask = 0x7f) {
+        Decode_Node leaf{LEAF, format, (uint16_t) mnemonic};
+        for (int f3 = 0; f3 < 8; f3++) {
+            if (funct3 == RM ? f3 == 5 || f3 == 6 : funct3 != ANY && funct3 != f3) continue;
+            Decode_Node& root = nodes[((opcode >> 2) << 3) | f3];
+            if (funct7 == ANY) {
+                root = leaf;
+                continue;
+            }
+            if (root.kind != BY_FUNCT7) {
+                Decode_Node old = root;
+                root = Decode_Node{BY_FUNCT7, Format::NONE, alloc(128, old)};
+            }
+            for (uint32_t f7 = 0; f7 < 128; f7++) {
+                if ((f7 & funct7_mask) != (uint32_t) funct7) continue;
+                Decode_Node& node = nodes[root.value + f7];
+                if (rs2 == ANY) {
+                    node = leaf;
+                    continue;
+                }
+                if (node.kind != BY_RS2) {
+                    Decode_Node old = node;
+                    node = Decode_Node{BY_RS2, Format::NONE, alloc(32, old)};
+                }
+                nodes[node.value + rs2] = leaf;
+            }
+        }
+    }
+};
+
+using M = Mnemonic;
+using F = Format;
+
+constexpr void add_base(Decode_Tables& t, Xlen xlen) {
+    //// В RV64 бит 25 - старший бит shamt, а не часть funct7.
+    const uint32_t shift_mask = xlen == Xlen::RV64 ? 0x7e : 0x7f;
+
+    t.add(0b0110111, ANY, ANY, ANY, M::LUI, F::U);
+    t.add(0b0010111, ANY, ANY, ANY, M::AUIPC, F::U);
+    t.add(0b1101111, ANY, ANY, ANY, M::JAL, F::J);
+    t.add(0b1100111, 0b000, ANY, ANY, M::JALR, F::I);
+
+    t.add(0b1100011, 0b000, ANY, ANY, M::BEQ, F::B);
+    t.add(0b1100011, 0b001, ANY, ANY, M::BNE, F::B);
+    t.add(0b1100011, 0b100, ANY, ANY, M::BLT, F::B);
+    t.add(0b1100011, 0b101, ANY, ANY, M::BGE, F::B);
+    t.add(0b1100011, 0b110, ANY, ANY, M::BLTU, F::B);
+    t.add(0b1100011, 0b111, ANY, ANY, M::BGEU, F::B);
+
+    t.add(0b0000011, 0b000, ANY, ANY, M::LB, F::LOAD);
+    t.add(0b0000011, 0b001, ANY, ANY, M::LH, F::LOAD);
+    t.add(0b0000011, 0b010, ANY, ANY, M::LW, F::LOAD);
+    t.add(0b0000011, 0b100, ANY, ANY, M::LBU, F::LOAD);
+    t.add(0b0000011, 0b101, ANY, ANY, M::LHU, F::LOAD);
+
+    t.add(0b0100011, 0b000, ANY, ANY, M::SB, F::S);
+    t.add(0b0100011, 0b001, ANY, ANY, M::SH, F::S);
+    t.add(0b0100011, 0b010, ANY, ANY, M::SW, F::S);
+
+    t.add(0b0010011, 0b000, ANY, ANY, M::ADDI, F::I);
+    t.add(0b0010011, 0b010, ANY, ANY, M::SLTI, F::I);
+    t.add(0b0010011, 0b011, ANY, ANY, M::SLTIU, F::I);
+    t.add(0b0010011, 0b100, ANY, ANY, M::XORI, F::I);
+    t.add(0b0010011, 0b110, ANY, ANY, M::ORI, F::I);
+    t.add(0b0010011, 0b111, ANY, ANY, M::ANDI, F::I);
+    t.add(0b0010011, 0b001, 0b0000000, ANY, M::SLLI, F::SHIFT, shift_mask);
+    t.add(0b0010011, 0b101, 0b0000000, ANY, M::SRLI, F::SHIFT, shift_mask);
+    t.add(0b0010011, 0b101, 0b0100000, ANY, M::SRAI, F::SHIFT, shift_mask);
+
+    t.add(0b0110011, 0b000, 0b0000000, ANY, M::ADD, F::R);
+    t.add(0b0110011, 0b000, 0b0100000, ANY, M::SUB, F::R);
+    t.add(0b0110011, 0b001, 0b0000000, ANY, M::SLL, F::R);
+    t.add(0b0110011, 0b010, 0b0000000, ANY, M::SLT, F::R);
+    t.add(0b0110011, 0b011, 0b0000000, ANY, M::SLTU, F::R);
+    t.add(0b0110011, 0b100, 0b0000000, ANY, M::XOR, F::R);
+    t.add(0b0110011, 0b101, 0b0000000, ANY, M::SRL, F::R);
+    t.add(0b0110011, 0b101, 0b0100000, ANY, M::SRA, F::R);
+    t.add(0b0110011, 0b110, 0b0000000, ANY, M::OR, F::R);
+    t.add(0b0110011, 0b111, 0b0000000, ANY, M::AND, F::R);
+
+    //// ld/lwu/sd и команды *w есть только в RV64.
+    if (xlen == Xlen::RV64) {
+        t.add(0b0000011, 0b011, ANY, ANY, M::LD, F::LOAD);
+        t.add(0b0000011, 0b110, ANY, ANY, M::LWU, F::LOAD);
+        t.add(0b0100011, 0b011, ANY, ANY, M::SD, F::S);
+
+        t.add(0b0011011, 0b000, ANY, ANY, M::ADDIW, F::I);
+        t.add(0b0011011, 0b001, 0b0000000, ANY, M::SLLIW, F::SHIFT);
+        t.add(0b0011011, 0b101, 0b0000000, ANY, M::SRLIW, F::SHIFT);
+        t.add(0b0011011, 0b101, 0b0100000, ANY, M::SRAIW, F::SHIFT);
+
+        t.add(0b0111011, 0b000, 0b0000000, ANY, M::ADDW, F::R);
+        t.add(0b0111011, 0b000, 0b0100000, ANY, M::SUBW, F::R);
+        t.add(0b0111011, 0b001, 0b0000000, ANY, M::SLLW, F::R);
+        t.add(0b0111011, 0b101, 0b0000000, ANY, M::SRLW, F::R);
+        t.add(0b0111011, 0b101, 0b0100000, ANY, M::SRAW, F::R);
+    }
+
+    t.add(0b0001111, 0b000, ANY, ANY, M::FENCE, F::I);
+    t.add(0b0001111, 0b001, ANY, ANY, M::FENCE_I, F::I);
+    t.add(0b1110011, 0b000, 0b0000000, 0b00000, M::ECALL, F::NONE);
+    t.add(0b1110011, 0b000, 0b0000000, 0b00001, M::EBREAK, F::NONE);
+}
+
+constexpr void add_m(Decode_Tables& t, Xlen xlen) {
+    t.add(0b0110011, 0b000, 0b0000001, ANY, M::MUL, F::R);
+    t.add(0b0110011, 0b001, 0b0000001, ANY, M::MULH, F::R);
+    t.add(0b0110011, 0b010, 0b0000001, ANY, M::MULHSU, F::R);
+    t.add(0b0110011, 0b011, 0b0000001, ANY, M::MULHU, F::R);
+    t.add(0b0110011, 0b100, 0b0000001, ANY, M::DIV, F::R);
+    t.add(0b0110011, 0b101, 0b0000001, ANY, M::DIVU, F::R);
+    t.add(0b0110011, 0b110, 0b0000001, ANY, M::REM, F::R);
+    t.add(0b0110011, 0b111, 0b0000001, ANY, M::REMU, F::R);
+    if (xlen == Xlen::RV64) {
+        t.add(0b0111011, 0b000, 0b0000001, ANY, M::MULW, F::R);
+        t.add(0b0111011, 0b100, 0b0000001, ANY, M::DIVW, F::R);
+        t.add(0b0111011, 0b101, 0b0000001, ANY, M::DIVUW, F::R);
+        t.add(0b0111011, 0b110, 0b0000001, ANY, M::REMW, F::R);
+        t.add(0b0111011, 0b111, 0b0000001, ANY, M::REMUW, F::R);
+    }
+}
+
+//// funct7 = funct5 | aq | rl: биты aq/rl маской не проверяются.
+constexpr void add_a(Decode_Tables& t, Xlen xlen) {
+    const Mnemonic ops[2][11] = {
+            {M::LR_W, M::SC_W, M::AMOSWAP_W, M::AMOADD_W, M::AMOXOR_W, M::AMOAND_W, M::AMOOR_W,
+             M::AMOMIN_W, M::AMOMAX_W, M::AMOMINU_W, M::AMOMAXU_W},
+            {M::LR_D, M::SC_D, M::AMOSWAP_D, M::AMOADD_D, M::AMOXOR_D, M::AMOAND_D, M::AMOOR_D,
+             M::AMOMIN_D, M::AMOMAX_D, M::AMOMINU_D, M::AMOMAXU_D},
+    };
+    const int funct5[11] = {0b00010, 0b00011, 0b00001, 0b00000, 0b00100, 0b01100, 0b01000,
+                            0b10000, 0b10100, 0b11000, 0b11100};
+    for (int width = 0; width < (xlen == Xlen::RV64 ? 2 : 1); width++) {
+        int funct3 = 0b010 + width;
+        t.add(0b0101111, funct3, funct5[0] << 2, 0, ops[width][0], F::LR, 0x7c);
+        for (int i = 1; i < 11; i++) t.add(0b0101111, funct3, funct5[i] << 2, ANY, ops[width][i], F::AMO, 0x7c);
+    }
+}
+
+//// Общее для F и D: fmt (биты 26:25) - 0 для S, 1 для D.
+constexpr void add_float(Decode_Tables& t, Xlen xlen, bool is_double) {
+    const int fmt = is_double ? 1 : 0;
+    const bool rv64 = xlen == Xlen::RV64;
+    auto op = [is_double](Mnemonic single, Mnemonic double_) { return is_double ? double_ : single; };
+
+    t.add(0b0000111, 0b010 + fmt, ANY, ANY, op(M::FLW, M::FLD), F::F_LOAD);
+    t.add(0b0100111, 0b010 + fmt, ANY, ANY, op(M::FSW, M::FSD), F::F_STORE);
+
+    t.add(0b1000011, RM, fmt, ANY, op(M::FMADD_S, M::FMADD_D), F::F_FFFF_RM, 0b11);
+    t.add(0b1000111, RM, fmt, ANY, op(M::FMSUB_S, M::FMSUB_D), F::F_FFFF_RM, 0b11);
+    t.add(0b1001011, RM, fmt, ANY, op(M::FNMSUB_S, M::FNMSUB_D), F::F_FFFF_RM, 0b11);
+    t.add(0b1001111, RM, fmt, ANY, op(M::FNMADD_S, M::FNMADD_D), F::F_FFFF_RM, 0b11);
+
+    const uint32_t OP_FP = 0b1010011;
+    t.add(OP_FP, RM, 0b0000000 | fmt, ANY, op(M::FADD_S, M::FADD_D), F::F_FFF_RM);
+    t.add(OP_FP, RM, 0b0000100 | fmt, ANY, op(M::FSUB_S, M::FSUB_D), F::F_FFF_RM);
+    t.add(OP_FP, RM, 0b0001000 | fmt, ANY, op(M::FMUL_S, M::FMUL_D), F::F_FFF_RM);
+    t.add(OP_FP, RM, 0b0001100 | fmt, ANY, op(M::FDIV_S, M::FDIV_D), F::F_FFF_RM);
+    t.add(OP_FP, RM, 0b0101100 | fmt, 0, op(M::FSQRT_S, M::FSQRT_D), F::F_FF_RM);
+    t.add(OP_FP, 0b000, 0b0010000 | fmt, ANY, op(M::FSGNJ_S, M::FSGNJ_D), F::F_FFF);
+    t.add(OP_FP, 0b001, 0b0010000 | fmt, ANY, op(M::FSGNJN_S, M::FSGNJN_D), F::F_FFF);
+    t.add(OP_FP, 0b010, 0b0010000 | fmt, ANY, op(M::FSGNJX_S, M::FSGNJX_D), F::F_FFF);
+    t.add(OP_FP, 0b000, 0b0010100 | fmt, ANY, op(M::FMIN_S, M::FMIN_D), F::F_FFF);
+    t.add(OP_FP, 0b001, 0b0010100 | fmt, ANY, op(M::FMAX_S, M::FMAX_D), F::F_FFF);
+    t.add(OP_FP, 0b010, 0b1010000 | fmt, ANY, op(M::FEQ_S, M::FEQ_D), F::F_XFF);
+    t.add(OP_FP, 0b001, 0b1010000 | fmt, ANY, op(M::FLT_S, M::FLT_D), F::F_XFF);
+    t.add(OP_FP, 0b000, 0b1010000 | fmt, ANY, op(M::FLE_S, M::FLE_D), F::F_XFF);
+    t.add(OP_FP, 0b001, 0b1110000 | fmt, 0, op(M::FCLASS_S, M::FCLASS_D), F::F_XF);
+
+    t.add(OP_FP, RM, 0b1100000 | fmt, 0, op(M::FCVT_W_S, M::FCVT_W_D), F::F_XF_RM);
+    t.add(OP_FP, RM, 0b1100000 | fmt, 1, op(M::FCVT_WU_S, M::FCVT_WU_D), F::F_XF_RM);
+    //// Перевод 32-битного целого в double точен: поле rm не влияет и не печатается.
+    const Format int_to_float = is_double ? F::F_FX : F::F_FX_RM;
+    t.add(OP_FP, RM, 0b1101000 | fmt, 0, op(M::FCVT_S_W, M::FCVT_D_W), int_to_float);
+    t.add(OP_FP, RM, 0b1101000 | fmt, 1, op(M::FCVT_S_WU, M::FCVT_D_WU), int_to_float);
+    if (rv64) {
+        t.add(OP_FP, RM, 0b1100000 | fmt, 2, op(M::FCVT_L_S, M::FCVT_L_D), F::F_XF_RM);
+        t.add(OP_FP, RM, 0b1100000 | fmt, 3, op(M::FCVT_LU_S, M::FCVT_LU_D), F::F_XF_RM);
+        t.add(OP_FP, RM, 0b1101000 | fmt, 2, op(M::FCVT_S_L, M::FCVT_D_L), F::F_FX_RM);
+        t.add(OP_FP, RM, 0b1101000 | fmt, 3, op(M::FCVT_S_LU, M::FCVT_D_LU), F::F_FX_RM);
+    }
+    //// fmv.x.d/fmv.d.x есть только в RV64: в RV32 регистр x уже 64-битного значения.
+    if (!is_double || rv64) {
+        t.add(OP_FP, 0b000, 0b1110000 | fmt, 0, op(M::FMV_X_W, M::FMV_X_D), F::F_XF);
+        t.add(OP_FP, 0b000, 0b1111000 | fmt, 0, op(M::FMV_W_X, M::FMV_D_X), F::F_FX);
+    }
+    if (is_double) {
+        t.add(OP_FP, RM, 0b0100000, 1, M::FCVT_S_D, F::F_FF_RM);
+        t.add(OP_FP, RM, 0b0100001, 0, M::FCVT_D_S, F::F_FF);
+    }
+}
+
+constexpr void add_f(Decode_Tables& t, Xlen xlen) {
+    add_float(t, xlen, false);
+}
+
+constexpr void add_d(Decode_Tables& t, Xlen xlen) {
+    add_float(t, xlen, true);
+}
+
+constexpr void add_zicsr(Decode_Tables& t, Xlen) {
+    t.add(0b1110011, 0b001, ANY, ANY, M::CSRRW, F::CSR);
+    t.add(0b1110011, 0b010, ANY, ANY, M::CSRRS, F::CSR);
+    t.add(0b1110011, 0b011, ANY, ANY, M::CSRRC, F::CSR);
+    t.add(0b1110011, 0b101, ANY, ANY, M::CSRRWI, F::CSR_IMM);
+    t.add(0b1110011, 0b110, ANY, ANY, M::CSRRSI, F::CSR_IMM);
+    t.add(0b1110011, 0b111, ANY, ANY, M::CSRRCI, F::CSR_IMM);
+}
+
+constexpr void add_zba(Decode_Tables& t, Xlen xlen) {
+    t.add(0b0110011, 0b010, 0b0010000, ANY, M::SH1ADD, F::R);
+    t.add(0b0110011, 0b100, 0b0010000, ANY, M::SH2ADD, F::R);
+    t.add(0b0110011, 0b110, 0b0010000, ANY, M::SH3ADD, F::R);
+    if (xlen != Xlen::RV64) return;
+    t.add(0b0111011, 0b000, 0b0000100, ANY, M::ADD_UW, F::R);
+    t.add(0b0111011, 0b010, 0b0010000, ANY, M::SH1ADD_UW, F::R);
+    t.add(0b0111011, 0b100, 0b0010000, ANY, M::SH2ADD_UW, F::R);
+    t.add(0b0111011, 0b110, 0b0010000, ANY, M::SH3ADD_UW, F::R);
+    t.add(0b0011011, 0b001, 0b0000100, ANY, M::SLLI_UW, F::SHIFT, 0x7e);
+}
+
+constexpr void add_zbb(Decode_Tables& t, Xlen xlen) {
+    const bool rv64 = xlen == Xlen::RV64;
+    t.add(0b0110011, 0b111, 0b0100000, ANY, M::ANDN, F::R);
+    t.add(0b0110011, 0b110, 0b0100000, ANY, M::ORN, F::R);
+    t.add(0b0110011, 0b100, 0b0100000, ANY, M::XNOR, F::R);
+    t.add(0b0110011, 0b110, 0b0000101, ANY, M::MAX, F::R);
+    t.add(0b0110011, 0b111, 0b0000101, ANY, M::MAXU, F::R);
+    t.add(0b0110011, 0b100, 0b0000101, ANY, M::MIN, F::R);
+    t.add(0b0110011, 0b101, 0b0000101, ANY, M::MINU, F::R);
+    t.add(0b0110011, 0b001, 0b0110000, ANY, M::ROL, F::R);
+    t.add(0b0110011, 0b101, 0b0110000, ANY, M::ROR, F::R);
+
+    t.add(0b0010011, 0b001, 0b0110000, 0b00000, M::CLZ, F::UNARY);
+    t.add(0b0010011, 0b001, 0b0110000, 0b00001, M::CTZ, F::UNARY);
+    t.add(0b0010011, 0b001, 0b0110000, 0b00010, M::CPOP, F::UNARY);
+    t.add(0b0010011, 0b001, 0b0110000, 0b00100, M::SEXT_B, F::UNARY);
+    t.add(0b0010011, 0b001, 0b0110000, 0b00101, M::SEXT_H, F::UNARY);
+    t.add(0b0010011, 0b101, 0b0110000, ANY, M::RORI, F::SHIFT, rv64 ? 0x7e : 0x7f);
+    t.add(0b0010011, 0b101, 0b0010100, 0b00111, M::ORC_B, F::UNARY);
+    t.add(0b0010011, 0b101, rv64 ? 0b0110101 : 0b0110100, 0b11000, M::REV8, F::UNARY);
+    t.add(rv64 ? 0b0111011 : 0b0110011, 0b100, 0b0000100, 0b00000, M::ZEXT_H, F::UNARY);
+    if (!rv64) return;
+    t.add(0b0011011, 0b001, 0b0110000, 0b00000, M::CLZW, F::UNARY);
+    t.add(0b0011011, 0b001, 0b0110000, 0b00001, M::CTZW, F::UNARY);
+    t.add(0b0011011, 0b001, 0b0110000, 0b00010, M::CPOPW, F::UNARY);
+    t.add(0b0111011, 0b001, 0b0110000, ANY, M::ROLW, F::R);
+    t.add(0b0111011, 0b101, 0b0110000, ANY, M::RORW, F::R);
+    t.add(0b0011011, 0b101, 0b0110000, ANY, M::RORIW, F::SHIFT);
+}
+
+//// Таблицы расширений: build_tables добавляет в дерево команды включённых. C здесь нет -
+//// сжатые команды разворачиваются отдельной таблицей.
+struct Extension_Table {
+    Extension extension;
+    void (*add)(Decode_Tables& t, Xlen xlen);
+};
+
+constexpr Extension_Table EXTENSION_TABLES[] = {
+        {Extension::M, add_m},
+        {Extension::A, add_a},
+        {Extension::F, add_f},
+        {Extension::D, add_d},
+        {Extension::ZICSR, add_zicsr},
+        {Extension::ZBA, add_zba},
+        {Extension::ZBB, add_zbb},
+};
+
+constexpr Decode_Tables build_tables(Xlen xlen, Extension_Set extensions) {
+    Decode_Tables t;
+    add_base(t, xlen);
+    for (const Extension_Table& table : EXTENSION_TABLES) {
+        if (extensions & extension_bit(table.extension)) table.add(t, xlen);
+    }
+    return t;
+}
+
+//// Таблицы для всех расширений строятся при компиляции; для другого набора - в set_extensions.
+constexpr Decode_Tables TABLES[2] = {build_tables(Xlen::RV32, ALL_EXTENSIONS),
+                                     build_tables(Xlen::RV64, ALL_EXTENSIONS)};
+
+constexpr std::string_view MNEMONIC_NAMES[] = {
+#define DISASM_MNEMONIC_NAME(id, name) name,
+    DISASM_MNEMONICS(DISASM_MNEMONIC_NAME)
+#undef DISASM_MNEMONIC_NAME
+};
+
+inline uint32_t field(uint32_t n, size_t pos, size_t len) {
+    return (n >> pos) & ((1u << len) - 1);
+}
+
+inline int32_t sign_extend(uint32_t n, size_t len) {
+    return (int32_t) (n << (32 - len)) >> (32 - len);
+}
+
+
+//// Сжатая команда, развёрнутая в эквивалентную 32-битную.
+struct Compressed_Entry {
+    Mnemonic mnemonic = Mnemonic::UNKNOWN;
+    Format format = Format::NONE;
+    uint8_t rd = 0;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    int32_t imm = 0;
+};
+
+Compressed_Entry make_entry(Mnemonic mnemonic, Format format, uint32_t rd, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    return Compressed_Entry{mnemonic, format, (uint8_t) rd, (uint8_t) rs1, (uint8_t) rs2, imm};
+}
+
+Compressed_Entry expand_compressed(uint32_t c, Xlen xlen, Extension_Set extensions) {
+    const bool rv64 = xlen == Xlen::RV64;
+    //// c.flw/c.fsw (только RV32) и c.fld/c.fsd - при включённых F и D.
+    const bool has_f = !rv64 && (extensions & extension_bit(Extension::F));
+    const bool has_d = extensions & extension_bit(Extension::D);
+    const uint32_t SP = 2;
+    const uint32_t RA = 1;
+    uint32_t funct3 = field(c, 13, 3);
+    uint32_t rd = field(c, 7, 5);
+    uint32_t rs2 = field(c, 2, 5);
+    uint32_t rd_c = field(c, 2, 3) + 8;
+    uint32_t rs1_c = field(c, 7, 3) + 8;
+    int32_t imm6 = sign_extend((field(c, 12, 1) << 5) | field(c, 2, 5), 6);
+    uint32_t shamt = (field(c, 12, 1) << 5) | field(c, 2, 5);
+    int32_t j_offset = sign_extend((field(c, 12, 1) << 11) | (field(c, 11, 1) << 4) | (field(c, 9, 2) << 8) |
+                                   (field(c, 8, 1) << 10) | (field(c, 7, 1) << 6) | (field(c, 6, 1) << 7) |
+                                   (field(c, 3, 3) << 1) | (field(c, 2, 1) << 5), 12);
+    int32_t b_offset = sign_extend((field(c, 12, 1) << 8) | (field(c, 10, 2) << 3) | (field(c, 5, 2) << 6) |
+                                   (field(c, 3, 2) << 1) | (field(c, 2, 1) << 5), 9);
+    uint32_t w_offset = (field(c, 10, 3) << 3) | (field(c, 6, 1) << 2) | (field(c, 5, 1) << 6);
+    uint32_t d_offset = (field(c, 10, 3) << 3) | (field(c, 5, 2) << 6);
+    //// В RV32 shamt[5] == 1 зарезервирован.
+    uint32_t shamt_limit = rv64 ? 64 : 32;
+
+    switch (field(c, 0, 2)) {
+        case 0b00:
+            switch (funct3) {
+                case 0b000: {
+                    uint32_t nzuimm = (field(c, 11, 2) << 4) | (field(c, 7, 4) << 6) |
+                            (field(c, 6, 1) << 2) | (field(c, 5, 1) << 3);
+                    if (nzuimm == 0) break;
+                    return make_entry(M::ADDI, F::I, rd_c, SP, 0, nzuimm);
+                }
+                case 0b001:
+                    if (!has_d) break;
+                    return make_entry(M::FLD, F::F_LOAD, rd_c, rs1_c, 0, d_offset);
+                case 0b010:
+                    return make_entry(M::LW, F::LOAD, rd_c, rs1_c, 0, w_offset);
+                case 0b011:
+                    if (has_f) return make_entry(M::FLW, F::F_LOAD, rd_c, rs1_c, 0, w_offset);
+                    if (!rv64) break;
+                    return make_entry(M::LD, F::LOAD, rd_c, rs1_c, 0, d_offset);
+                case 0b101:
+                    if (!has_d) break;
+                    return make_entry(M::FSD, F::F_STORE, 0, rs1_c, rd_c, d_offset);
+                case 0b110:
+                    return make_entry(M::SW, F::S, 0, rs1_c, rd_c, w_offset);
+                case 0b111:
+                    if (has_f) return make_entry(M::FSW, F::F_STORE, 0, rs1_c, rd_c, w_offset);
+                    if (!rv64) break;
+                    return make_entry(M::SD, F::S, 0, rs1_c, rd_c, d_offset);
+                default:
+                    break;
+            }
+            break;
+        case 0b01:
+            switch (funct3) {
+                case 0b000:
+                    return make_entry(M::ADDI, F::I, rd, rd, 0, imm6);
+                case 0b001:
+                    if (rv64) {
+                        if (rd == 0) break;
+                        return make_entry(M::ADDIW, F::I, rd, rd, 0, imm6);
+                    }
+                    return make_entry(M::JAL, F::J, RA, 0, 0, j_offset);
+                case 0b010:
+                    return make_entry(M::ADDI, F::I, rd, 0, 0, imm6);
+                case 0b011:
+                    if (rd == SP) {
+                        int32_t nzimm = sign_extend((field(c, 12, 1) << 9) | (field(c, 6, 1) << 4) |
+                                                    (field(c, 5, 1) << 6) | (field(c, 3, 2) << 7) |
+                                                    (field(c, 2, 1) << 5), 10);
+                        if (nzimm == 0) break;
+                        return make_entry(M::ADDI, F::I, SP, SP, 0, nzimm);
+                    }
+                    if (imm6 == 0) break;
+                    return make_entry(M::LUI, F::U, rd, 0, 0, (int32_t) ((uint32_t) imm6 << 12));
+                case 0b100:
+                    switch (field(c, 10, 2)) {
+                        case 0b00:
+                            if (shamt >= shamt_limit) break;
+                            return make_entry(M::SRLI, F::SHIFT, rs1_c, rs1_c, 0, shamt);
+                        case 0b01:
+                            if (shamt >= shamt_limit) break;
+                            return make_entry(M::SRAI, F::SHIFT, rs1_c, rs1_c, 0, shamt);
+                        case 0b10:
+                            return make_entry(M::ANDI, F::I, rs1_c, rs1_c, 0, imm6);
+                        default: {
+                            if (field(c, 12, 1) == 0) {
+                                const Mnemonic ops[4] = {M::SUB, M::XOR, M::OR, M::AND};
+                                return make_entry(ops[field(c, 5, 2)], F::R, rs1_c, rs1_c, rd_c, 0);
+                            }
+                            if (!rv64 || field(c, 6, 1) != 0) break;
+                            const Mnemonic ops_w[2] = {M::SUBW, M::ADDW};
+                            return make_entry(ops_w[field(c, 5, 1)], F::R, rs1_c, rs1_c, rd_c, 0);
+                        }
+                    }
+                    break;
+                case 0b101:
+                    return make_entry(M::JAL, F::J, 0, 0, 0, j_offset);
+                case 0b110:
+                    return make_entry(M::BEQ, F::B, 0, rs1_c, 0, b_offset);
+                case 0b111:
+                    return make_entry(M::BNE, F::B, 0, rs1_c, 0, b_offset);
+            }
+            break;
+        case 0b10:
+            switch (funct3) {
+                case 0b000:
+                    if (shamt >= shamt_limit) break;
+                    return make_entry(M::SLLI, F::SHIFT, rd, rd, 0, shamt);
+                case 0b001: {
+                    if (!has_d) break;
+                    uint32_t offset = (field(c, 12, 1) << 5) | (field(c, 5, 2) << 3) | (field(c, 2, 3) << 6);
+                    return make_entry(M::FLD, F::F_LOAD, rd, SP, 0, offset);
+                }
+                case 0b010: {
+                    if (rd == 0) break;
+                    uint32_t offset = (field(c, 12, 1) << 5) | (field(c, 4, 3) << 2) | (field(c, 2, 2) << 6);
+                    return make_entry(M::LW, F::LOAD, rd, SP, 0, offset);
+                }
+                case 0b011: {
+                    if (has_f) {
+                        uint32_t offset = (field(c, 12, 1) << 5) | (field(c, 4, 3) << 2) | (field(c, 2, 2) << 6);
+                        return make_entry(M::FLW, F::F_LOAD, rd, SP, 0, offset);
+                    }
+                    if (!rv64 || rd == 0) break;
+                    uint32_t offset = (field(c, 12, 1) << 5) | (field(c, 5, 2) << 3) | (field(c, 2, 3) << 6);
+                    return make_entry(M::LD, F::LOAD, rd, SP, 0, offset);
+                }
+                case 0b100:
+                    if (field(c, 12, 1) == 0) {
+                        if (rs2 == 0) {
+                            if (rd == 0) break;
+                            return make_entry(M::JALR, F::I, 0, rd, 0, 0);
+                        }
+                        return make_entry(M::ADD, F::R, rd, 0, rs2, 0);
+                    }
+                    if (rs2 == 0) {
+                        if (rd == 0) return make_entry(M::EBREAK, F::NONE, 0, 0, 0, 0);
+                        return make_entry(M::JALR, F::I, RA, rd, 0, 0);
+                    }
+                    return make_entry(M::ADD, F::R, rd, rd, rs2, 0);
+                case 0b101: {
+                    if (!has_d) break;
+                    uint32_t offset = (field(c, 10, 3) << 3) | (field(c, 7, 3) << 6);
+                    return make_entry(M::FSD, F::F_STORE, 0, SP, rs2, offset);
+                }
+                case 0b110: {
+                    uint32_t offset = (field(c, 9, 4) << 2) | (field(c, 7, 2) << 6);
+                    return make_entry(M::SW, F::S, 0, SP, rs2, offset);
+                }
+                case 0b111: {
+                    if (has_f) {
+                        uint32_t offset = (field(c, 9, 4) << 2) | (field(c, 7, 2) << 6);
+                        return make_entry(M::FSW, F::F_STORE, 0, SP, rs2, offset);
+                    }
+                    if (!rv64) break;
+                    uint32_t offset = (field(c, 10, 3) << 3) | (field(c, 7, 3) << 6);
+                    return make_entry(M::SD, F::S, 0, SP, rs2, offset);
+                }
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+    return Compressed_Entry{};
+}
+
+Extension_Set active_extensions = ALL_EXTENSIONS;
+//// Дерево 32-битных команд для текущего набора: по умолчанию готовое TABLES.
+const Decode_Node* active_nodes[2] = {TABLES[0].nodes.data(), TABLES[1].nodes.data()};
+std::unique_ptr<Decode_Tables> custom_tables[2];
+
+//// Таблица сжатых команд строится при первом обращении, каждая для своей разрядности.
+std::mutex compressed_mutex;
+std::atomic<const Compressed_Entry*> compressed_tables[2];
+std::vector<Compressed_Entry> compressed_storage[2];
+
+const Compressed_Entry* build_compressed_table(Xlen xlen) {
+    std::lock_guard<std::mutex> lock(compressed_mutex);
+    std::vector<Compressed_Entry>& entries = compressed_storage[(size_t) xlen];
+    if (const Compressed_Entry* ready = compressed_tables[(size_t) xlen].load()) return ready;
+    entries.assign(1 << 16, Compressed_Entry{});
+    if (active_extensions & extension_bit(Extension::C)) {
+        for (uint32_t c = 0; c < entries.size(); c++) {
+            if (field(c, 0, 2) != 3) entries[c] = expand_compressed(c, xlen, active_extensions);
+        }
+    }
+    compressed_tables[(size_t) xlen].store(entries.data(), std::memory_order_release);
+    return entries.data();
+}
+
+inline const Compressed_Entry* compressed_table(Xlen xlen) {
+    const Compressed_Entry* table = compressed_tables[(size_t) xlen].load(std::memory_order_acquire);
+    return table ? table : build_compressed_table(xlen);
+}
+
+}
+
+
+void set_extensions(Extension_Set extensions) {
+    std::lock_guard<std::mutex> lock(compressed_mutex);
+    active_extensions = extensions & ALL_EXTENSIONS;
+    for (Xlen xlen : {Xlen::RV32, Xlen::RV64}) {
+        size_t x = (size_t) xlen;
+        if (active_extensions == ALL_EXTENSIONS) {
+            active_nodes[x] = TABLES[x].nodes.data();
+            custom_tables[x].reset();
+        }
+        else {
+            custom_tables[x] = std::make_unique<Decode_Tables>(build_tables(xlen, active_extensions));
+            active_nodes[x] = custom_tables[x]->nodes.data();
+        }
+        compressed_tables[x].store(nullptr);
+    }
+}
+
+Extension_Set enabled_extensions() {
+    return active_extensions;
+}
+
+bool parse_march(std::string_view march, Extension_Set& extensions) {
+    if (march.substr(0, 4) != "rv32" && march.substr(0, 4) != "rv64") return false;
+    march.remove_prefix(4);
+    if (march.empty() || (march[0] != 'i' && march[0] != 'g')) return false;
+    Extension_Set result = 0;
+    if (march[0] == 'g') {
+        result |= extension_bit(Extension::M) | extension_bit(Extension::A) | extension_bit(Extension::F) |
+                  extension_bit(Extension::D) | extension_bit(Extension::ZICSR);
+    }
+    march.remove_prefix(1);
+    const std::string_view LETTERS = "mafdc";
+    const Extension LETTER_EXTENSIONS[] = {Extension::M, Extension::A, Extension::F, Extension::D, Extension::C};
+    while (!march.empty() && march[0] != '_') {
+        size_t i = LETTERS.find(march[0]);
+        if (i == std::string_view::npos) return false;
+        result |= extension_bit(LETTER_EXTENSIONS[i]);
+        march.remove_prefix(1);
+    }
+    while (!march.empty()) {
+        march.remove_prefix(1);
+        std::string_view name = march.substr(0, march.find('_'));
+        march.remove_prefix(name.size());
+        if (name == "zicsr") result |= extension_bit(Extension::ZICSR);
+        else if (name == "zba") result |= extension_bit(Extension::ZBA);
+        else if (name == "zbb") result |= extension_bit(Extension::ZBB);
+        //// fence.i декодируется всегда.
+        else if (name != "zifencei") return false;
+    }
+    if (result & extension_bit(Extension::F)) result |= extension_bit(Extension::ZICSR);
+    if ((result & extension_bit(Extension::D)) && !(result & extension_bit(Extension::F))) return false;
+    extensions = result;
+    return true;
+}
+
+std::string_view mnemonic_name(Mnemonic mnemonic) {
+    return MNEMONIC_NAMES[(size_t) mnemonic];
+}
+
+Instruction decode_compressed(uint16_t raw, uint64_t address, Xlen xlen) {
+    const Compressed_Entry& entry = compressed_table(xlen)[raw];
+    Instruction inst{};
+    inst.address = address;
+    inst.raw = raw;
+    inst.length = 2;
+    inst.mnemonic = entry.mnemonic;
+    inst.format = entry.format;
+    inst.rd = entry.rd;
+    inst.rs1 = entry.rs1;
+    inst.rs2 = entry.rs2;
+    inst.imm = entry.imm;
+    return inst;
+}
+
+Instruction decode_instruction(uint32_t raw, uint64_t address, Xlen xlen) {
+    Instruction inst{};
+    inst.address = address;
+    inst.raw = raw;
+    inst.length = 4;
+    inst.rd = field(raw, 7, 5);
+    inst.rs1 = field(raw, 15, 5);
+    inst.rs2 = field(raw, 20, 5);
+    if (field(raw, 0, 2) != 3) return inst;
+
+    const Decode_Node* nodes = active_nodes[(size_t) xlen];
+    const Decode_Node* node = &nodes[(field(raw, 2, 5) << 3) | field(raw, 12, 3)];
+    if (node->kind == BY_FUNCT7) node = &nodes[node->value + field(raw, 25, 7)];
+    if (node->kind == BY_RS2) node = &nodes[node->value + inst.rs2];
+    inst.mnemonic = (Mnemonic) node->value;
+    inst.format = node->format;
+
+    //// Знак расширяется через sign_extend: сдвиг отрицательного int32_t влево - UB.
+    switch (inst.format) {
+        case Format::I:
+        case Format::LOAD:
+        case Format::F_LOAD:
+            inst.imm = sign_extend(field(raw, 20, 12), 12);
+            break;
+        case Format::SHIFT:
+            inst.imm = field(raw, 20, 6);
+            break;
+        case Format::S:
+        case Format::F_STORE:
+            inst.imm = sign_extend((field(raw, 25, 7) << 5) | field(raw, 7, 5), 12);
+            break;
+        case Format::B:
+            inst.imm = sign_extend((field(raw, 31, 1) << 12) | (field(raw, 7, 1) << 11) |
+                                   (field(raw, 25, 6) << 5) | (field(raw, 8, 4) << 1), 13);
+            break;
+        case Format::U:
+            inst.imm = (int32_t) (raw & 0xfffff000);
+            break;
+        case Format::J:
+            inst.imm = sign_extend((field(raw, 31, 1) << 20) | (field(raw, 12, 8) << 12) |
+                                   (field(raw, 20, 1) << 11) | (field(raw, 21, 10) << 1), 21);
+            break;
+        case Format::CSR:
+        case Format::CSR_IMM:
+            inst.imm = field(raw, 20, 12);
+            break;
+        case Format::F_FFFF_RM:
+            inst.rs3 = field(raw, 27, 5);
+            break;
+        default:
+            break;
+    }
+    return inst;
+}
@@ -0,0 +1,484 @@
+#include "disasm_server.h"
+#include "disassembler.h"
+#include "instruction_iterator.h"
+#include "server_protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DISASM_SERVER_SOCKET 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+//// Листинг диапазона в одном ответе; больше - ошибка, диапазон нужно сузить.
+const size_t MAX_LISTING_SIZE = MAX_RESPONSE_SIZE - (1 << 10);
+//// Для одной строки ответа: буфер без приёмника растёт сам.
+const size_t SMALL_BUFFER_SIZE = 256;
+
+Server_Image::Code_Section::Code_Section(const Elf_Image& image, const Section& section, const RWer& rw):
+        info(section_info(section)),
+        text(image.data(info.sh_offset, info.sh_size)),
+        scan(text, info.sh_size),
+        labels(rw.section_labels(info.index)) {
+    const Symbol_Table& symbols = rw.symbol_table();
+    for (uint32_t i : rw.section_symbols(info.index)) {
+        if ((symbols.infos[i] & 0xf) == STT_FUNC) functions.push_back(i);
+    }
+    std::stable_sort(functions.begin(), functions.end(), [&symbols](uint32_t a, uint32_t b) {
+        return symbols.values[a] < symbols.values[b];
+    });
+}
+
+Server_Image::Server_Image(const std::string& filename):
+        _image(filename),
+        _header(_image),
+        _sections(_header.section_index(_image)),
+        _rw(&_text, &_symtab, &_strtab, _header.elf_class()) {
+    _header.search_sections_info(_sections, _text, _symtab, _strtab);
+    _rw.processing_symtable(_image);
+    for (const Section* section : _sections.executable()) {
+        _code.push_back(std::make_unique<Code_Section>(_image, *section, _rw));
+    }
+
+    const Symbol_Table& symbols = _rw.symbol_table();
+    std::vector<std::string_view> names(symbols.size());
+    _by_name.resize(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) {
+        names[i] = symbols.name(i);
+        _by_name[i] = i;
+    }
+    //// При равных именах - по адресу, как их и возвращает find_symbols.
+    std::sort(_by_name.begin(), _by_name.end(), [&names, &symbols](uint32_t a, uint32_t b) {
+        if (names[a] != names[b]) return names[a] < names[b];
+        return symbols.values[a] < symbols.values[b];
+    });
+}
+
+uint64_t Server_Image::memory() const {
+    const Symbol_Table& symbols = _rw.symbol_table();
+    uint64_t total = _image.size() + _sections.size() * sizeof(Section);
+    //// Таблица символов, индекс по секциям и по именам, метки RWer текущей секции.
+    total += symbols.size() * (2 * sizeof(uint64_t) + 2 + sizeof(uint16_t) + 3 * sizeof(uint32_t));
+    total += _rw.label_index().size() * 16 + _rw.label_index().names().size();
+    for (const auto& section : _code) {
+        total += section->scan.starts().size() * sizeof(uint64_t);
+        total += section->labels.size() * 16 + section->labels.names().size();
+        total += section->functions.size() * sizeof(uint32_t);
+    }
+    return total;
+}
+
+void Server_Image::write_range(uint64_t begin, uint64_t end, Output_Buffer& output) const {
+    for (const auto& section : _code) {
+        const Section_Info& info = section->info;
+        uint64_t first = std::max(begin, info.sh_addr);
+        uint64_t last = std::min(end, info.sh_addr + info.sh_size);
+        if (first >= last) continue;
+        output.append(info.name);
+        output.put('\n');
+        size_t offset = section->scan.next_start(first - info.sh_addr);
+        Label_Index::Cursor label(section->labels, info.sh_addr + offset);
+        Instruction_Iterator it(section->text, info.sh_size, offset, info.sh_addr, _rw.xlen());
+        for (; it != Instruction_Iterator() && it->address < last; ++it) {
+            write_instruction_line(output, *it, label.at(it->address));
+            if (output.view().size() > MAX_LISTING_SIZE)
+                throw DisassemblerException("Listing is too large, narrow the address range!");
+        }
+        output.put('\n');
+    }
+}
+
+std::vector<uint32_t> Server_Image::find_symbols(std::string_view name) const {
+    const Symbol_Table& symbols = _rw.symbol_table();
+    auto first = std::lower_bound(_by_name.begin(), _by_name.end(), name, [&symbols](uint32_t i,
+                                                                                  std::string_view value) {
+        return symbols.name(i) < value;
+    });
+    std::vector<uint32_t> result;
+    for (auto it = first; it != _by_name.end() && symbols.name(*it) == name; ++it) {
+        unsigned char type = symbols.infos[*it] & 0xf;
+        if (symbols.indices[*it] == 0 || type == STT_SECTION || type == STT_FILE) continue;
+        result.push_back(*it);
+    }
+    return result;
+}
+
+const Symbol_Table& Server_Image::symbols() const {
+    return _rw.symbol_table();
+}
+
+std::string_view Server_Image::section_name(uint32_t symbol) const {
+    uint16_t index = _rw.symbol_table().indices[symbol];
+    return index < _sections.size() ? _sections[index].name : std::string_view();
+}
+
+bool Server_Image::instruction_at(uint64_t address, Instruction& inst, std::string& function,
+                                  std::string& line) const {
+    for (const auto& section : _code) {
+        const Section_Info& info = section->info;
+        if (address < info.sh_addr || address - info.sh_addr >= info.sh_size) continue;
+        //// Команда не длиннее 4 байт: её начало - это полуслово или предыдущее.
+        size_t offset = (address - info.sh_addr) & ~(uint64_t) 1;
+        if (!section->scan.is_start(offset)) {
+            if (offset == 0 || !section->scan.is_start(offset - 2)) return false;
+            offset -= 2;
+        }
+        Instruction_Iterator it(section->text, info.sh_size, offset, info.sh_addr, _rw.xlen());
+        if (it == Instruction_Iterator() || address >= it->address + it->length) return false;
+        inst = *it;
+
+        const Symbol_Table& symbols = _rw.symbol_table();
+        auto next = std::upper_bound(section->functions.begin(), section->functions.end(), inst.address,
+                                     [&symbols](uint64_t value, uint32_t i) {
+                                         return value < symbols.values[i];
+                                     });
+        function.clear();
+        if (next != section->functions.begin()) {
+            uint32_t symbol = *(next - 1);
+            Output_Buffer text((std::ostream*) nullptr, SMALL_BUFFER_SIZE);
+            text.append(symbols.name(symbol));
+            text.append("+0x");
+            text.append_hex(inst.address - symbols.values[symbol], 1);
+            function = text.view();
+        }
+
+        Output_Buffer text((std::ostream*) nullptr, SMALL_BUFFER_SIZE);
+        write_instruction_line(text, inst, section->labels.find(inst.address));
+        std::string_view view = text.view();
+        line.assign(view.substr(0, view.size() - 1));
+        return true;
+    }
+    return false;
+}
+
+
+Image_Cache::Image_Cache(uint64_t limit):
+        _limit(limit) {}
+
+#ifdef DISASM_SERVER_SOCKET
+const Server_Image& Image_Cache::get(const std::string& filename) {
+    struct stat st;
+    if (filename == STDIN_NAME || stat(filename.c_str(), &st) != 0) {
+        throw DisassemblerException("Unable to open elf file!");
+    }
+#ifdef __APPLE__
+    int64_t mtime = (int64_t) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    int64_t mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    uint64_t size = st.st_size;
+
+    auto found = _by_name.find(filename);
+    if (found != _by_name.end()) {
+        auto entry = found->second;
+        if (entry->size == size && entry->mtime == mtime) {
+            _hits++;
+            _entries.splice(_entries.begin(), _entries, entry);
+            return *entry->image;
+        }
+        _memory -= entry->memory;
+        _by_name.erase(found);
+        _entries.erase(entry);
+    }
+
+    _misses++;
+    auto image = std::make_unique<Server_Image>(filename);
+    uint64_t memory = image->memory();
+    _entries.push_front(Entry{filename, size, mtime, std::move(image), memory});
+    _by_name[filename] = _entries.begin();
+    _memory += memory;
+    evict();
+    return *_entries.front().image;
+}
+#else
+const Server_Image& Image_Cache::get(const std::string&) {
+    throw DisassemblerException("Unable to open elf file!");
+}
+#endif
+
+void Image_Cache::evict() {
+    while (_memory > _limit && _entries.size() > 1) {
+        Entry& oldest = _entries.back();
+        _memory -= oldest.memory;
+        _by_name.erase(oldest.filename);
+        _entries.pop_back();
+        _evictions++;
+    }
+}
+
+size_t Image_Cache::size() const {
+    return _entries.size();
+}
+
+uint64_t Image_Cache::memory() const {
+    return _memory;
+}
+
+uint64_t Image_Cache::limit() const {
+    return _limit;
+}
+
+uint64_t Image_Cache::hits() const {
+    return _hits;
+}
+
+uint64_t Image_Cache::misses() const {
+    return _misses;
+}
+
+uint64_t Image_Cache::evictions() const {
+    return _evictions;
+}
+
+
+static std::string error_response(std::string_view message) {
+    Message_Writer response;
+    response.put_u8((uint8_t) Response_Status::ERROR);
+    response.put_string(message);
+    return std::string(response.frame());
+}
+
+static std::string answer(Image_Cache& cache, std::string_view request) {
+    Message_Reader reader(request);
+    Message_Writer response;
+    response.put_u8((uint8_t) Response_Status::OK);
+    Request_Type type = (Request_Type) reader.get_u8();
+    switch (type) {
+        case Request_Type::DISASSEMBLE: {
+            std::string filename(reader.get_string());
+            uint64_t begin = reader.get_u64();
+            uint64_t end = reader.get_u64();
+            const Server_Image& image = cache.get(filename);
+            Output_Buffer listing((std::ostream*) nullptr, STREAM_OUTPUT_BUFFER_SIZE);
+            image.write_range(begin, end, listing);
+            response.put_string(listing.view());
+            break;
+        }
+        case Request_Type::SYMBOL: {
+            std::string filename(reader.get_string());
+            std::string_view name = reader.get_string();
+            const Server_Image& image = cache.get(filename);
+            std::vector<uint32_t> found = image.find_symbols(name);
+            if (found.empty()) throw DisassemblerException("Symbol not found: " + std::string(name));
+            response.put_u32(found.size());
+            for (uint32_t i : found) {
+                response.put_u64(image.symbols().values[i]);
+                response.put_u64(image.symbols().sizes[i]);
+                response.put_u8(image.symbols().infos[i]);
+                response.put_string(image.section_name(i));
+            }
+            break;
+        }
+        case Request_Type::INSTRUCTION: {
+            std::string filename(reader.get_string());
+            uint64_t address = reader.get_u64();
+            const Server_Image& image = cache.get(filename);
+            Instruction inst;
+            std::string function, line;
+            if (!image.instruction_at(address, inst, function, line)) {
+                Output_Buffer text((std::ostream*) nullptr, SMALL_BUFFER_SIZE);
+                text.append("No instruction at address: 0x");
+                text.append_hex(address, 1);
+                throw DisassemblerException(std::string(text.view()));
+            }
+            response.put_u64(inst.address);
+            response.put_u32(inst.raw);
+            response.put_u8(inst.length);
+            response.put_string(function);
+            response.put_string(line);
+            break;
+        }
+        case Request_Type::STATUS:
+            response.put_u32(cache.size());
+            response.put_u64(cache.memory());
+            response.put_u64(cache.limit());
+            response.put_u64(cache.hits());
+            response.put_u64(cache.misses());
+            response.put_u64(cache.evictions());
+            break;
+        default:
+            throw DisassemblerException("Wrong request type: " + std::to_string((int) type));
+    }
+    if (!reader.done()) throw DisassemblerException("Wrong message: unexpected data at the end!");
+    return std::string(response.frame());
+}
+
+std::string handle_request(Image_Cache& cache, std::string_view request) {
+    try {
+        return answer(cache, request);
+    }
+    catch (DisassemblerException& e) {
+        return error_response(e.get_message());
+    }
+    catch (std::bad_alloc&) {
+        return error_response("Unable to allocate memory.");
+    }
+    //// Любой сбой в обработке одного запроса не должен останавливать сервер.
+    catch (std::exception& e) {
+        return error_response(std::string("Internal error: ") + e.what());
+    }
+}
+
+
+#ifdef DISASM_SERVER_SOCKET
+static volatile std::sig_atomic_t server_stop = 0;
+
+static void stop_server(int) {
+    server_stop = 1;
+}
+
+//// Соединение с клиентом: принятые, но ещё не разобранные байты
+//// и ответы, которые клиент ещё не забрал.
+struct Client {
+    int fd;
+    std::string input;
+    std::string output;
+};
+
+//// Пишет сколько примет сокет; false - клиента надо отключить.
+static bool flush_client(Client& client) {
+    size_t written = 0;
+    while (written < client.output.size()) {
+        ssize_t n = ::write(client.fd, client.output.data() + written, client.output.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) return false;
+        written += n;
+    }
+    client.output.erase(0, written);
+    return true;
+}
+
+//// Отвечает на целые кадры из input, пока сокет принимает ответы целиком;
+//// остальные запросы ждут, пока клиент не заберёт отправленное. false - клиента надо отключить.
+static bool serve_client(Image_Cache& cache, Client& client) {
+    size_t used = 0;
+    bool ok = true;
+    while (ok && client.output.empty() && client.input.size() - used >= FRAME_HEADER_SIZE) {
+        uint32_t size = frame_size(client.input.data() + used);
+        if (size > MAX_REQUEST_SIZE) return false;
+        if (client.input.size() - used - FRAME_HEADER_SIZE < size) break;
+        std::string_view request(client.input.data() + used + FRAME_HEADER_SIZE, size);
+        used += FRAME_HEADER_SIZE + size;
+        client.output = handle_request(cache, request);
+        ok = flush_client(client);
+    }
+    client.input.erase(0, used);
+    return ok;
+}
+
+//// Сокет, оставшийся от завершившегося аварийно сервера, мешает bind. Удаляется только сокет,
+//// на котором никто не слушает; false - по пути лежит что-то другое или живой сервер.
+static bool remove_stale_socket(const std::string& socket_path, const sockaddr_un& address) {
+    struct stat st{};
+    if (lstat(socket_path.c_str(), &st) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode)) return false;
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) return false;
+    bool alive = connect(probe, (const sockaddr*) &address, sizeof(address)) == 0;
+    close(probe);
+    return !alive && unlink(socket_path.c_str()) == 0;
+}
+
+void run_server(const std::string& socket_path, uint64_t memory_limit) {
+    sockaddr_un address{};
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        throw DisassemblerException("Wrong socket path: " + socket_path);
+    }
+    address.sun_family = AF_UNIX;
+    socket_path.copy(address.sun_path, socket_path.size());
+
+    if (!remove_stale_socket(socket_path, address)) {
+        throw DisassemblerException("Unable to listen on socket: " + socket_path);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) throw DisassemblerException("Unable to create socket!");
+    struct stat created{};
+    if (bind(listener, (sockaddr*) &address, sizeof(address)) != 0) {
+        close(listener);
+        throw DisassemblerException("Unable to listen on socket: " + socket_path);
+    }
+    lstat(socket_path.c_str(), &created);
+    if (listen(listener, 16) != 0) {
+        close(listener);
+        unlink(socket_path.c_str());
+        throw DisassemblerException("Unable to listen on socket: " + socket_path);
+    }
+
+    //// Без SA_RESTART: сигнал прерывает poll, и цикл проверяет server_stop.
+    struct sigaction action{};
+    action.sa_handler = stop_server;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    Image_Cache cache(memory_limit);
+    std::vector<Client> clients;
+    std::vector<pollfd> polled;
+    std::vector<char> chunk(1 << 16);
+    while (!server_stop) {
+        polled.assign(1, pollfd{listener, POLLIN, 0});
+        //// Пока клиент не забрал ответы, его новые запросы не читаются:
+        //// медленный клиент ждёт сам и не задерживает остальных.
+        for (const Client& client : clients) {
+            polled.push_back(pollfd{client.fd, (short) (client.output.empty() ? POLLIN : POLLOUT), 0});
+        }
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        std::vector<Client> alive;
+        for (size_t i = 0; i < clients.size(); i++) {
+            Client& client = clients[i];
+            bool keep = true;
+            if (!client.output.empty()) {
+                if (polled[i + 1].revents != 0) keep = flush_client(client) && serve_client(cache, client);
+            }
+            else if (polled[i + 1].revents != 0) {
+                ssize_t n = read(client.fd, chunk.data(), chunk.size());
+                if (n > 0) {
+                    client.input.append(chunk.data(), n);
+                    keep = serve_client(cache, client);
+                }
+                else keep = n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+            if (keep) alive.push_back(std::move(client));
+            else close(client.fd);
+        }
+        clients = std::move(alive);
+
+        if (polled[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            //// Неблокирующий сокет: write не остановит сервер на клиенте, который не читает ответы.
+            if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+                close(fd);
+                fd = -1;
+            }
+            if (fd >= 0) clients.push_back(Client{fd, std::string(), std::string()});
+        }
+    }
+
+    for (const Client& client : clients) close(client.fd);
+    close(listener);
+    //// Удаляется только свой сокет: путь могли занять заново, пока сервер работал.
+    struct stat current{};
+    if (lstat(socket_path.c_str(), &current) == 0 && S_ISSOCK(current.st_mode) &&
+        current.st_dev == created.st_dev && current.st_ino == created.st_ino) {
+        unlink(socket_path.c_str());
+    }
+}
+#else
+void run_server(const std::string&, uint64_t) {
+    throw DisassemblerException("Server mode needs Unix domain sockets!");
+}
+#endif
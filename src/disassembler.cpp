@@ -1,313 +1,268 @@
-#include <valarray>
-#include <cstring>
-#include <fstream>
-#include <iostream>
-#include <string>
 #include "disassembler.h"
+#include <algorithm>
+#include <iterator>
 
 
 uint32_t get_bits(uint32_t n, size_t pos, size_t len) {
     return ((n >> pos) & ((1 << len) - 1));
 }
 
-static std::string decode_reg(uint32_t reg) {
-    if (reg == 0) return "zero";
-    if (reg == 1) return "ra";
-    if (reg == 2) return "sp";
-    if (reg == 3) return "gp";
-    if (reg == 4) return "tp";
-    if (reg >= 5 && reg <= 7) return ("t" + std::to_string(reg - 5));
-    if (reg >= 8 && reg <= 9) return ("s" + std::to_string(reg - 8));
-    if (reg >= 10 && reg <= 17) return ("a" + std::to_string(reg - 10));
-    if (reg >= 18 && reg <= 27) return ("s" + std::to_string(reg - 16));
-    if (reg >= 28 && reg <= 31) return ("t" + std::to_string(reg - 25));
-    return "-";
+static const std::string_view REG_NAMES[32] = {
+        "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+        "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+        "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+        "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+static const std::string_view FREG_NAMES[32] = {
+        "ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7",
+        "fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5",
+        "fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7",
+        "fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11"
+};
+
+//// 101 и 110 зарезервированы, 111 (dyn) не печатается.
+static const std::string_view ROUNDING_MODES[8] = {"rne", "rtz", "rdn", "rup", "rmm", "rm5", "rm6", "dyn"};
+
+struct Csr_Name {
+    uint16_t number;
+    std::string_view name;
+};
+
+//// По возрастанию номеров; остальные CSR печатаются числом.
+static const Csr_Name CSR_NAMES[] = {
+        {0x001, "fflags"}, {0x002, "frm"}, {0x003, "fcsr"},
+        {0x100, "sstatus"}, {0x104, "sie"}, {0x105, "stvec"}, {0x106, "scounteren"},
+        {0x140, "sscratch"}, {0x141, "sepc"}, {0x142, "scause"}, {0x143, "stval"}, {0x144, "sip"},
+        {0x180, "satp"},
+        {0x300, "mstatus"}, {0x301, "misa"}, {0x302, "medeleg"}, {0x303, "mideleg"}, {0x304, "mie"},
+        {0x305, "mtvec"}, {0x306, "mcounteren"}, {0x320, "mcountinhibit"},
+        {0x340, "mscratch"}, {0x341, "mepc"}, {0x342, "mcause"}, {0x343, "mtval"}, {0x344, "mip"},
+        {0xb00, "mcycle"}, {0xb02, "minstret"}, {0xb80, "mcycleh"}, {0xb82, "minstreth"},
+        {0xc00, "cycle"}, {0xc01, "time"}, {0xc02, "instret"},
+        {0xc80, "cycleh"}, {0xc81, "timeh"}, {0xc82, "instreth"},
+        {0xf11, "mvendorid"}, {0xf12, "marchid"}, {0xf13, "mimpid"}, {0xf14, "mhartid"},
+};
+
+//// Пронумерованные семейства: first печатается как prefix, номер first_index, suffix.
+struct Csr_Family {
+    uint16_t first;
+    uint16_t last;
+    uint16_t first_index;
+    std::string_view prefix;
+    std::string_view suffix;
+};
+
+static const Csr_Family CSR_FAMILIES[] = {
+        {0x323, 0x33f, 3, "mhpmevent", ""},
+        {0x3a0, 0x3af, 0, "pmpcfg", ""},
+        {0x3b0, 0x3ef, 0, "pmpaddr", ""},
+        {0xb03, 0xb1f, 3, "mhpmcounter", ""},
+        {0xb83, 0xb9f, 3, "mhpmcounter", "h"},
+        {0xc03, 0xc1f, 3, "hpmcounter", ""},
+        {0xc83, 0xc9f, 3, "hpmcounter", "h"},
+};
+
+std::string_view reg_name(uint32_t reg) {
+    if (reg >= 32) return "-";
+    return REG_NAMES[reg];
 }
 
-
-void write_big_instruction(std::ofstream& output, uint32_t num, uint32_t big_inst, std::string label) {
-    std::string rec = "unknown_command";
-    uint8_t opcode = get_bits(big_inst, 0, 7);
-    if (opcode == 0b0110011 || opcode == 0b0111011) {
-        R_type r_inst = R_type(big_inst);
-        rec = r_inst.to_string();
-    }
-    if (opcode == 0b0000011 || opcode == 0b0001111 || opcode == 0b0010011 ||
-        opcode == 0b0011011 || opcode == 0b1100111 || opcode == 0b1110011) {
-        I_type i_inst = I_type(big_inst);
-        rec = i_inst.to_string();
-    }
-    if (opcode == 0b0100011) {
-        S_type s_inst = S_type(big_inst);
-        rec = s_inst.to_string();
-    }
-    if (opcode == 0b1100011 ) {
-        B_type b_inst = B_type(big_inst);
-        rec = b_inst.to_string();
-    }
-    if (opcode == 0b0010111 || opcode == 0b0110111) {
-        U_type u_inst = U_type(big_inst);
-        rec = u_inst.to_string();
-    }
-    if (opcode == 0b1101111) {
-        J_type j_inst = J_type(big_inst);
-        rec = j_inst.to_string();
-    }
-
-    char str[100];
-    sprintf(str, "%08x %10s: %s\n", num, label.data(), rec.data());
-    output << str;
-}
-
-
-R_type::R_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    fun3 = get_bits(s_command, 12, 3);
-    fun7 = get_bits(s_command, 25, 7);
-    rs1 = get_bits(s_command, 15, 5);
-    rs2 = get_bits(s_command, 20, 5);
-    rd = get_bits(s_command, 7, 5);
-}
-
-std::string R_type::command_to_string() const {
-    if (opcode == 0b0110011) {
-        if (fun7 == 0b0000001) {
-            if (fun3 == 0b000) return "mul";
-            if (fun3 == 0b001) return "mulh";
-            if (fun3 == 0b010) return "mulhsu";
-            if (fun3 == 0b011) return "mulhu";
-            if (fun3 == 0b100) return "div";
-            if (fun3 == 0b101) return "divu";
-            if (fun3 == 0b110) return "rem";
-            if (fun3 == 0b111) return "remu";
-        }
-
-        if (fun3 == 0b000) {
-            if (fun7 == 0b0000000) return "add";
-            if (fun7 == 0b0100000) return "sub";
-        }
-        if (fun3 == 0b001) return "sll";
-        if (fun3 == 0b010) return "slt";
-        if (fun3 == 0b011) return "sltu";
-        if (fun3 == 0b100) return "xor";
-        if (fun3 == 0b101) {
-            if (fun7 == 0b0000000) return "srl";
-            if (fun7 == 0b0100000) return "sra";
-        }
-        if (fun3 == 0b110) return "or";
-        if (fun3 == 0b111) return "and";
-    }
-    if (opcode == 0b0111011) {
-        if (fun3 == 0b000) {
-            if (fun7 == 0b0000000) return "addw";
-            if (fun7 == 0b0100000) return "subw";
-        }
-        if (fun3 == 0b001) return "sllw";
-        if (fun3 == 0b101) {
-            if (fun7 == 0b0000000) return "srlw";
-            if (fun7 == 0b0100000) return "sraw";
-        }
-    }
-    return "unknown_command";
+std::string_view freg_name(uint32_t reg) {
+    if (reg >= 32) return "-";
+    return FREG_NAMES[reg];
 }
 
-std::string R_type::to_string() const {
-    char inst[100];
-    sprintf(inst, "%s %s, %s, %s",
-            command_to_string().data(), decode_reg(rd).data(), decode_reg(rs1).data(), decode_reg(rs2).data());
-    return inst;
+std::string_view csr_name(uint32_t csr) {
+    auto it = std::lower_bound(std::begin(CSR_NAMES), std::end(CSR_NAMES), csr, [](const Csr_Name& entry,
+                                                                                 uint32_t value) {
+        return entry.number < value;
+    });
+    return it != std::end(CSR_NAMES) && it->number == csr ? it->name : std::string_view();
 }
 
 
-I_type::I_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    fun3 = get_bits(s_command, 12, 3);
-    rs1 = get_bits(s_command, 15, 5);
-    rd = get_bits(s_command, 7, 5);
-    imm = get_bits(s_command, 20, 12);
-}
-
-std::string I_type::command_to_string() const {
-    if (opcode == 0b0000011) {
-        if (fun3 == 0b000) return "lb";
-        if (fun3 == 0b001) return "lh";
-        if (fun3 == 0b010) return "lw";
-        if (fun3 == 0b011) return "ld";
-        if (fun3 == 0b100) return "lbu";
-        if (fun3 == 0b101) return "lhu";
-        if (fun3 == 0b110) return "lwu";
-    }
-    if (opcode == 0b0001111) {
-        if (fun3 == 0b000) return "fence";
-        if (fun3 == 0b001) return "fence.i";
+static void write_csr(Output_Buffer& output, uint32_t csr) {
+    std::string_view name = csr_name(csr);
+    if (!name.empty()) {
+        output.append(name);
+        return;
     }
-    if (opcode == 0b0010011) {
-        if (fun3 == 0b000) return "addi";
-        if (fun3 == 0b001) return "slli";
-        if (fun3 == 0b010) return "slti";
-        if (fun3 == 0b011) return "sltiu";
-        if (fun3 == 0b100) return "xori";
-        if (fun3 == 0b101) {
-            if (get_bits(imm, 5, 7) == 0b0000000) return "srli";
-            if (get_bits(imm, 5, 7) == 0b0100000) return "srai";
-        }
-        if (fun3 == 0b110) return "ori";
-        if (fun3 == 0b111) return "andi";
-    }
-    if (opcode == 0b0011011) {
-        if (fun3 == 0b000) return "addiw";
-        if (fun3 == 0b001) return "slliw";
-        if (fun3 == 0b101) {
-            if (get_bits(imm, 5, 7) == 0b0000000) return "srliw";
-            if (get_bits(imm, 5, 7) == 0b0100000) return "sraiw";
-        }
-    }
-    if (opcode == 0b1100111) return "jalr";
-    if (opcode == 0b1110011) {
-        if (fun3 == 0b000) {
-            if (get_bits(imm, 5, 7) == 0) return "ecall";
-            if (get_bits(imm, 5, 7) == 1) return "ebreak";
-        }
+    for (const Csr_Family& family : CSR_FAMILIES) {
+        if (csr < family.first || csr > family.last) continue;
+        output.append(family.prefix);
+        output.append_udec(csr - family.first + family.first_index);
+        output.append(family.suffix);
+        return;
     }
-    return "unknown_command";
-}
-
-std::string I_type::to_string() const {
-    char inst[100];
-    if (opcode == 0b0000011)
-        sprintf(inst, "%s %s, %s(%s)",
-                command_to_string().data(), decode_reg(rd).data(), imm_to_str().data(), decode_reg(rs1).data());
-    else
-        sprintf(inst, "%s %s, %s, %s",
-                command_to_string().data(), decode_reg(rd).data(), decode_reg(rs1).data(), imm_to_str().data());
-
-    return inst;
+    output.append("0x");
+    output.append_hex(csr, 3);
 }
 
-std::string I_type::imm_to_str() const {
-    if (get_bits(imm, 11, 1) == 1) return (std::to_string((int)imm - (1 << 12)));
-    return std::to_string((int) imm);
-}
-
-
-S_type::S_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    fun3 = get_bits(s_command, 12, 3);
-    rs1 = get_bits(s_command, 15, 5);
-    rs2 = get_bits(s_command, 20, 5);
-    imm = get_bits(s_command, 7, 5) +
-            (get_bits(s_command, 25, 7) << 5);
-}
-
-std::string S_type::command_to_string() const {
-    if (opcode == 0b0100011) {
-        if (fun3 == 0b000) return "sb";
-        if (fun3 == 0b001) return "sh";
-        if (fun3 == 0b010) return "sw";
-        if (fun3 == 0b011) return "sd";
+//// rd, rs1, rs2, rs3 через запятую, сколько букв в classes: F - регистр f, X - регистр x.
+static void write_registers(Output_Buffer& output, std::string_view classes, const Instruction& inst) {
+    const uint8_t regs[4] = {inst.rd, inst.rs1, inst.rs2, inst.rs3};
+    for (size_t i = 0; i < classes.size(); i++) {
+        output.append(i == 0 ? " " : ", ");
+        output.append(classes[i] == 'F' ? FREG_NAMES[regs[i]] : REG_NAMES[regs[i]]);
     }
-    return "unknown_command";
-}
-
-std::string S_type::to_string() const {
-    char inst[100];
-    sprintf(inst, "%s %s, %s(%s)",
-            command_to_string().data(), decode_reg(rs1).data(), imm_to_str().data(), decode_reg(rs2).data());
-    return inst;
 }
 
-std::string S_type::imm_to_str() const {
-    if (get_bits(imm, 11, 1) == 1) return (std::to_string((int)imm - (1 << 12)));
-    return std::to_string((int) imm);
+static void write_rounding_mode(Output_Buffer& output, const Instruction& inst) {
+    uint32_t rm = get_bits(inst.raw, 12, 3);
+    if (rm == 0b111) return;
+    output.append(", ");
+    output.append(ROUNDING_MODES[rm]);
 }
 
-
-B_type::B_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    fun3 = get_bits(s_command, 12, 3);
-    rs1 = get_bits(s_command, 15, 5);
-    rs2 = get_bits(s_command, 20, 5);
-    imm = (get_bits(s_command, 7, 1) << 11) +
-            (get_bits(s_command, 8, 4) << 1) +
-            (get_bits(s_command, 25, 6) << 5) +
-            (get_bits(s_command, 31, 1) << 12);
+static void write_target(Output_Buffer& output, const Instruction& inst, const Label_Index::Cursor* targets) {
+    if (!targets) return;
+    std::string_view name = targets->find(inst.address + inst.imm);
+    if (name.empty()) return;
+    output.append(" <");
+    output.append(name);
+    output.put('>');
 }
 
-std::string B_type::command_to_string() const {
-    if (opcode == 0b1100011) {
-        if (fun3 == 0b000) return "beq";
-        if (fun3 == 0b001) return "bne";
-        if (fun3 == 0b100) return "blt";
-        if (fun3 == 0b101) return "bge";
-        if (fun3 == 0b110) return "bltu";
-        if (fun3 == 0b111) return "bgeu";
+void write_instruction(Output_Buffer& output, const Instruction& inst, const Label_Index::Cursor* targets) {
+    output.append(mnemonic_name(inst.mnemonic));
+    switch (inst.format) {
+        case Format::R:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            output.append(", ");
+            output.append(REG_NAMES[inst.rs1]);
+            output.append(", ");
+            output.append(REG_NAMES[inst.rs2]);
+            break;
+        case Format::I:
+        case Format::SHIFT:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            output.append(", ");
+            output.append(REG_NAMES[inst.rs1]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            break;
+        case Format::LOAD:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            output.put('(');
+            output.append(REG_NAMES[inst.rs1]);
+            output.put(')');
+            break;
+        case Format::S:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rs2]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            output.put('(');
+            output.append(REG_NAMES[inst.rs1]);
+            output.put(')');
+            break;
+        case Format::B:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rs1]);
+            output.append(", ");
+            output.append(REG_NAMES[inst.rs2]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            write_target(output, inst, targets);
+            break;
+        case Format::U:
+        case Format::J:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            if (inst.format == Format::J) write_target(output, inst, targets);
+            break;
+        case Format::UNARY:
+            write_registers(output, "XX", inst);
+            break;
+        case Format::CSR:
+        case Format::CSR_IMM:
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            output.append(", ");
+            write_csr(output, inst.imm);
+            output.append(", ");
+            if (inst.format == Format::CSR) output.append(REG_NAMES[inst.rs1]);
+            else output.append_udec(inst.rs1);
+            break;
+        case Format::LR:
+        case Format::AMO: {
+            const std::string_view ORDERING[4] = {"", ".rl", ".aq", ".aqrl"};
+            output.append(ORDERING[get_bits(inst.raw, 25, 2)]);
+            output.put(' ');
+            output.append(REG_NAMES[inst.rd]);
+            if (inst.format == Format::AMO) {
+                output.append(", ");
+                output.append(REG_NAMES[inst.rs2]);
+            }
+            output.append(", (");
+            output.append(REG_NAMES[inst.rs1]);
+            output.put(')');
+            break;
+        }
+        case Format::F_LOAD:
+        case Format::F_STORE:
+            output.put(' ');
+            output.append(FREG_NAMES[inst.format == Format::F_LOAD ? inst.rd : inst.rs2]);
+            output.append(", ");
+            output.append_dec(inst.imm);
+            output.put('(');
+            output.append(REG_NAMES[inst.rs1]);
+            output.put(')');
+            break;
+        case Format::F_FFF:
+            write_registers(output, "FFF", inst);
+            break;
+        case Format::F_FFF_RM:
+            write_registers(output, "FFF", inst);
+            write_rounding_mode(output, inst);
+            break;
+        case Format::F_FFFF_RM:
+            write_registers(output, "FFFF", inst);
+            write_rounding_mode(output, inst);
+            break;
+        case Format::F_FF:
+            write_registers(output, "FF", inst);
+            break;
+        case Format::F_FF_RM:
+            write_registers(output, "FF", inst);
+            write_rounding_mode(output, inst);
+            break;
+        case Format::F_XF:
+            write_registers(output, "XF", inst);
+            break;
+        case Format::F_XF_RM:
+            write_registers(output, "XF", inst);
+            write_rounding_mode(output, inst);
+            break;
+        case Format::F_FX:
+            write_registers(output, "FX", inst);
+            break;
+        case Format::F_FX_RM:
+            write_registers(output, "FX", inst);
+            write_rounding_mode(output, inst);
+            break;
+        case Format::F_XFF:
+            write_registers(output, "XFF", inst);
+            break;
+        default:
+            break;
     }
-    return "unknown_command";
-}
-
-std::string B_type::to_string() const {
-    char inst[100];
-    sprintf(inst, "%s %s, %s, %s",
-            command_to_string().data(), decode_reg(rs1).data(), decode_reg(rs2).data(), imm_to_str().data());
-    return inst;
-}
-
-std::string B_type::imm_to_str() const {
-    if (get_bits(imm, 12, 1) == 1) return (std::to_string((int)imm - (1 << 13)));
-    return std::to_string((int) imm);
-}
-
-
-U_type::U_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    rd = get_bits(s_command, 7, 5);
-    imm = get_bits(s_command, 12, 20) << 12;
 }
 
-std::string U_type::command_to_string() const {
-    if (opcode == 0b0010111) return "auipc";
-    if (opcode == 0b0110111) return "lui";
-    return "unknown_command";
+void write_instruction_line(Output_Buffer& output, const Instruction& inst, std::string_view label,
+                            const Label_Index::Cursor* targets) {
+    output.append_hex(inst.address, 8);
+    output.put(' ');
+    output.append_right(label, 10);
+    output.append(": ");
+    write_instruction(output, inst, targets);
+    output.put('\n');
 }
-
-std::string U_type::to_string() const {
-    char inst[100];
-    sprintf(inst, "%s %s, %s",
-            command_to_string().data(), decode_reg(rd).data(), imm_to_str().data());
-    return inst;
-}
-
-std::string U_type::imm_to_str() const {
-    if (get_bits(imm, 31, 1) == 1) return (std::to_string((int)imm - (1 << 32)));
-    return std::to_string((int) imm);
-}
-
-
-J_type::J_type(uint32_t s_command) {
-    opcode = get_bits(s_command, 0, 7);
-    rd = get_bits(s_command, 7, 5);
-    imm = (get_bits(s_command, 12, 7) << 12) +
-            (get_bits(s_command, 20, 1) << 11) +
-            (get_bits(s_command, 21, 10) << 1) +
-            (get_bits(s_command, 31, 1) << 20);
-}
-
-std::string J_type::command_to_string() const {
-    if (opcode == 0b1101111) return "jal";
-    return "unknown_command";
-}
-
-std::string J_type::to_string() const {
-    char inst[100];
-    sprintf(inst, "%s %s, %s",
-            command_to_string().data(), decode_reg(rd).data(), imm_to_str().data());
-    return inst;
-}
-
-std::string J_type::imm_to_str() const {
-    if (get_bits(imm, 20, 1) == 1) return (std::to_string((int)imm - (1 << 21)));
-    return std::to_string((int) imm);
-}
-
-
-
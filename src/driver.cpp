@@ -0,0 +1,261 @@
+#include "driver.h"
+#include "elf_parser.h"
+#include "binary_format.h"
+#include "elf_diff.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+namespace fs = std::filesystem;
+
+
+//// Диапазоны функций --symbol, обрезанные по --start/--stop.
+static std::vector<Address_Range> address_ranges(const Options& options, const RWer& rw) {
+    if (options.symbols.empty()) return {Address_Range{options.start, options.stop}};
+    std::vector<Address_Range> ranges = rw.symbol_ranges(options.symbols);
+    for (Address_Range& range : ranges) {
+        range.begin = std::max(range.begin, options.start);
+        range.end = std::min(range.end, options.stop);
+    }
+    return merge_ranges(std::move(ranges));
+}
+
+static void write_listing(const std::string& input, std::ostream& output, Output_Sink* sink, size_t buffer_size,
+                          const Options& options, Thread_Pool* pool, Listing_Cache* cache, File_Result& result) {
+    Elf_Image image(input);
+    result.bytes_in = image.size();
+    stats_add(Stats_Counter::BYTES_READ, image.size());
+    ELF_Header elf_header(image);
+    Section_Index sections = elf_header.section_index(image);
+    Section_Info s_i_text, s_i_symtable, strtab;
+    elf_header.search_sections_info(sections, s_i_text, s_i_symtable, strtab);
+
+    RWer rw(&s_i_text, &s_i_symtable, &strtab, elf_header.elf_class());
+    rw.processing_symtable(image);
+
+    std::ofstream cfg_file;
+    std::unique_ptr<Output_Buffer> cfg_output;
+    if (!options.cfg_file.empty()) {
+        cfg_file.open(options.cfg_file, std::ios::binary);
+        if (!cfg_file) {
+            throw DisassemblerException("Unable to open file for saving CFG!");
+        }
+        cfg_output = std::make_unique<Output_Buffer>(&cfg_file);
+        write_cfg_begin(*cfg_output, options.cfg_format);
+    }
+    bool first_section = true;
+    //// Граф строится до вывода секции: синтетические метки нужны уже в листинге.
+    auto analyze = [&](std::string_view name) {
+        if (!cfg_output && !options.labels) return;
+        Control_Flow_Graph cfg = rw.analyze_control_flow(image, pool, options.labels);
+        if (!cfg_output) return;
+        write_cfg_section(*cfg_output, options.cfg_format, cfg, rw.label_index(), name, s_i_text.index,
+                          first_section);
+        first_section = false;
+    };
+    auto finish_cfg = [&] {
+        if (!cfg_output) return;
+        write_cfg_end(*cfg_output, options.cfg_format);
+        cfg_output->flush();
+        if (!cfg_file.flush()) {
+            throw DisassemblerException("Unable to write CFG!");
+        }
+    };
+
+    if (options.format == Output_Format::BIN) {
+        analyze(s_i_text.name);
+        finish_cfg();
+        result.instructions = rw.processing_text_binary(image, output);
+        return;
+    }
+    Output_Buffer buffer(sink, buffer_size);
+    //// С --start/--stop/--symbol выводятся только выбранные команды, без .symtab.
+    bool filtered = has_address_filter(options);
+    std::vector<Address_Range> ranges;
+    if (filtered) ranges = address_ranges(options, rw);
+    //// Все секции с кодом (.init, .plt, .text.* и т.д.); если их нет - пустая .text, как раньше.
+    std::vector<const Section*> code = sections.executable();
+    if (code.empty() && !filtered) result.instructions = rw.processing_text(image, buffer, pool, cache);
+    for (const Section* section : code) {
+        s_i_text = section_info(*section);
+        analyze(s_i_text.name);
+        if (filtered) result.instructions += rw.processing_text_ranges(image, buffer, ranges);
+        else result.instructions += rw.processing_text(image, buffer, pool, cache);
+    }
+    finish_cfg();
+    if (!filtered) rw.write_symtab(buffer);
+    Phase_Timer timer(Stats_Phase::OUTPUT);
+    buffer.flush();
+}
+
+File_Result disassemble_file(const std::string& input, const std::string& output_filename, const Options& options,
+                             Thread_Pool* pool, Listing_Cache* cache) {
+    File_Result result;
+    result.input = input;
+    result.output = output_filename;
+    stats_add(Stats_Counter::FILES, 1);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        //// Текст пишется через приёмник (write/writev), двоичный листинг - через std::ostream.
+        bool to_stdout = output_filename == STDOUT_NAME;
+        std::ofstream file;
+        std::ostream* output = &std::cout;
+        std::unique_ptr<Output_Sink> sink;
+        if (options.format == Output_Format::BIN && !options.from_bin) {
+            if (!to_stdout) {
+                file.open(output_filename, std::ios::binary);
+                if (!file) {
+                    throw DisassemblerException("Unable to open file for saving result!");
+                }
+                output = &file;
+            }
+            sink = std::make_unique<Stream_Sink>(*output);
+        }
+        else {
+            sink = open_output_sink(output_filename, options.async_write);
+            if (!sink) {
+                throw DisassemblerException("Unable to open file for saving result!");
+            }
+        }
+        //// В канал пишем блоками поменьше, чтобы первые строки появлялись сразу.
+        size_t buffer_size = options.buffer_size != 0 ? options.buffer_size :
+                             to_stdout ? STREAM_OUTPUT_BUFFER_SIZE : OUTPUT_BUFFER_SIZE;
+
+        if (options.from_bin) {
+            Binary_Listing listing(input);
+            result.instructions = listing.size();
+            Output_Buffer buffer(sink.get(), buffer_size);
+            listing.write_text(buffer);
+            buffer.flush();
+        }
+        else {
+            write_listing(input, *output, sink.get(), buffer_size, options, pool, cache, result);
+        }
+        {
+            Phase_Timer timer(Stats_Phase::OUTPUT);
+            sink->flush();
+        }
+        result.bytes_out = file.is_open() ? (uint64_t) file.tellp() : sink->written();
+        if (!sink->good()) {
+            throw DisassemblerException("Unable to write result!");
+        }
+    }
+    catch (DisassemblerException& e) {
+        result.error = e.get_message();
+    }
+    catch (std::bad_alloc& e) {
+        result.error = "Unable to allocate memory.";
+    }
+    catch (std::exception& e) {
+        result.error = e.what();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::unique_ptr<Listing_Cache> open_listing_cache(const Options& options) {
+    if (!options.cache || options.cache_dir.empty() || options.from_bin || options.format != Output_Format::TEXT)
+        return nullptr;
+    std::error_code ec;
+    fs::create_directories(options.cache_dir, ec);
+    if (!fs::is_directory(options.cache_dir, ec)) return nullptr;
+    return std::make_unique<Listing_Cache>(options.cache_dir, options.cache_size);
+}
+
+std::vector<std::string> collect_batch_inputs(const Options& options) {
+    std::vector<std::string> inputs;
+    auto add = [&inputs](const std::string& path) {
+        std::error_code ec;
+        if (fs::is_directory(path, ec)) {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(path, ec)) {
+                if (entry.is_regular_file(ec)) inputs.push_back(entry.path().string());
+            }
+        }
+        else {
+            inputs.push_back(path);
+        }
+    };
+
+    if (!options.manifest.empty()) {
+        std::ifstream manifest(options.manifest);
+        if (!manifest) {
+            throw DisassemblerException("Unable to open manifest file!");
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty() && line[0] != '#') add(line);
+        }
+    }
+    for (const std::string& input : options.inputs) add(input);
+    return inputs;
+}
+
+size_t run_batch(const Options& options, Thread_Pool& pool) {
+    std::vector<std::string> inputs = collect_batch_inputs(options);
+    std::error_code ec;
+    fs::create_directories(options.output_dir, ec);
+
+    //// Одинаковые имена файлов из разных каталогов получают суффикс.
+    std::map<std::string, size_t> used_names;
+    std::vector<std::string> outputs;
+    for (const std::string& input : inputs) {
+        std::string name = fs::path(input).filename().string();
+        size_t n = used_names[name]++;
+        if (n != 0) name += "_" + std::to_string(n);
+        name += options.format == Output_Format::BIN && !options.from_bin ? ".bin" : ".txt";
+        outputs.push_back((fs::path(options.output_dir) / name).string());
+    }
+
+    std::unique_ptr<Listing_Cache> cache = open_listing_cache(options);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<File_Result> results(inputs.size());
+    parallel_for(&pool, inputs.size(), [&](size_t i) {
+        results[i] = disassemble_file(inputs[i], outputs[i], options, &pool, cache.get());
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    uint64_t bytes_in = 0, bytes_out = 0, instructions = 0;
+    for (const File_Result& result : results) {
+        if (!result.error.empty()) {
+            failed++;
+            printf("FAIL %s: %s\n", result.input.c_str(), result.error.c_str());
+            continue;
+        }
+        bytes_in += result.bytes_in;
+        bytes_out += result.bytes_out;
+        instructions += result.instructions;
+    }
+
+    double mb_in = bytes_in / 1e6;
+    printf("Files: %zu, ok: %zu, failed: %zu\n", results.size(), results.size() - failed, failed);
+    printf("Input: %.2f MB, output: %.2f MB, instructions: %llu\n",
+           mb_in, bytes_out / 1e6, (unsigned long long) instructions);
+    printf("Time: %.3f s, %.2f MB/s, %.0f instructions/s, %zu threads\n",
+           seconds, seconds > 0 ? mb_in / seconds : 0.0, seconds > 0 ? instructions / seconds : 0.0, pool.size());
+    return failed;
+}
+
+size_t run_diff(const Options& options, Thread_Pool* pool) {
+    std::string output_filename = options.inputs.size() == 3 ? options.inputs[2] : std::string(STDOUT_NAME);
+    std::unique_ptr<Output_Sink> sink = open_output_sink(output_filename, options.async_write);
+    if (!sink) {
+        throw DisassemblerException("Unable to open file for saving result!");
+    }
+    Output_Buffer buffer(sink.get(), options.buffer_size != 0 ? options.buffer_size : OUTPUT_BUFFER_SIZE);
+    Diff_Summary summary = write_elf_diff(options.inputs[0], options.inputs[1], buffer, pool);
+    {
+        Phase_Timer timer(Stats_Phase::OUTPUT);
+        buffer.flush();
+        sink->flush();
+    }
+    if (!sink->good()) {
+        throw DisassemblerException("Unable to write result!");
+    }
+    return summary.changed + summary.added + summary.removed;
+}
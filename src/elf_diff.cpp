@@ -0,0 +1,488 @@
+#include "elf_diff.h"
+#include "elf_parser.h"
+#include "disassembler.h"
+#include "hash.h"
+#include "instruction_iterator.h"
+#include <algorithm>
+#include <memory>
+
+
+//// Функция сравнения: FUNC ненулевого размера целиком внутри секции с кодом.
+//// Секция с кодом без таких символов сравнивается целиком под своим именем.
+struct Diff_Function {
+    std::string_view name;
+    uint32_t occurrence;
+    uint64_t address;
+    uint32_t size;
+    const uint8_t* bytes;
+    uint64_t hash;
+};
+
+//// Разобранный ELF: функции и символы, упорядоченные по адресу, для нормализации адресов.
+class Diff_Image {
+public:
+    explicit Diff_Image(const std::string& filename);
+    Diff_Image(const Diff_Image&) = delete;
+    Diff_Image& operator=(const Diff_Image&) = delete;
+
+    const std::vector<Diff_Function>& functions() const;
+    Xlen xlen() const;
+    //// Символ, внутри которого лежит address (или который на нём начинается), и смещение от него.
+    bool resolve(uint64_t address, std::string_view& name, uint64_t& offset) const;
+
+private:
+    void add_functions(const Section& section);
+
+    Elf_Image _image;
+    ELF_Header _header;
+    Section_Index _sections;
+    Section_Info _text, _symtab, _strtab;
+    RWer _rw;
+    std::vector<Diff_Function> _functions;
+    //// (адрес, номер символа) по возрастанию адреса.
+    std::vector<std::pair<uint64_t, uint32_t>> _by_address;
+};
+
+Diff_Image::Diff_Image(const std::string& filename):
+        _image(filename),
+        _header(_image),
+        _sections(_header.section_index(_image)),
+        _rw(&_text, &_symtab, &_strtab, _header.elf_class()) {
+    _header.search_sections_info(_sections, _text, _symtab, _strtab);
+    _rw.processing_symtable(_image);
+
+    const Symbol_Table& symbols = _rw.symbol_table();
+    for (size_t i = 0; i < symbols.size(); i++) {
+        unsigned char type = symbols.infos[i] & 0xf;
+        if (symbols.indices[i] == 0 || type == STT_SECTION || type == STT_FILE || symbols.name(i).empty()) continue;
+        _by_address.emplace_back(symbols.values[i], i);
+    }
+    std::sort(_by_address.begin(), _by_address.end());
+
+    for (const Section* section : _sections.executable()) add_functions(*section);
+    //// Одноимённые функции (static из разных файлов) различаются номером в порядке адресов.
+    std::sort(_functions.begin(), _functions.end(), [](const Diff_Function& a, const Diff_Function& b) {
+        return a.name != b.name ? a.name < b.name : a.address < b.address;
+    });
+    for (size_t i = 1; i < _functions.size(); i++) {
+        if (_functions[i].name == _functions[i - 1].name) _functions[i].occurrence = _functions[i - 1].occurrence + 1;
+    }
+}
+
+void Diff_Image::add_functions(const Section& section) {
+    Section_Info info = section_info(section);
+    const uint8_t* text = _image.data(info.sh_offset, info.sh_size);
+    const Symbol_Table& symbols = _rw.symbol_table();
+    size_t first = _functions.size();
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (symbols.indices[i] != section.index || (symbols.infos[i] & 0xf) != STT_FUNC || symbols.sizes[i] == 0)
+            continue;
+        if (symbols.values[i] < info.sh_addr) continue;
+        uint64_t offset = symbols.values[i] - info.sh_addr;
+        if (offset > info.sh_size || symbols.sizes[i] > info.sh_size - offset) continue;
+        _functions.push_back(Diff_Function{symbols.name(i), 0, symbols.values[i], (uint32_t) symbols.sizes[i],
+                                           text + offset, 0});
+    }
+    if (_functions.size() == first && info.sh_size != 0)
+        _functions.push_back(Diff_Function{section.name, 0, info.sh_addr, info.sh_size, text, 0});
+    for (size_t i = first; i < _functions.size(); i++) {
+        _functions[i].hash = xxhash64(_functions[i].bytes, _functions[i].size);
+    }
+}
+
+const std::vector<Diff_Function>& Diff_Image::functions() const {
+    return _functions;
+}
+
+Xlen Diff_Image::xlen() const {
+    return _rw.xlen();
+}
+
+//// Ближайший снизу символ может оказаться меткой без размера внутри функции,
+//// поэтому проверяется несколько предыдущих.
+bool Diff_Image::resolve(uint64_t address, std::string_view& name, uint64_t& offset) const {
+    const size_t LOOKBACK = 4;
+    auto it = std::upper_bound(_by_address.begin(), _by_address.end(), std::make_pair(address, UINT32_MAX));
+    const Symbol_Table& symbols = _rw.symbol_table();
+    for (size_t step = 0; step < LOOKBACK && it != _by_address.begin(); step++) {
+        --it;
+        uint64_t delta = address - it->first;
+        if (delta == 0 || delta < symbols.sizes[it->second]) {
+            name = symbols.name(it->second);
+            offset = delta;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//// Команда с ключом сравнения. В ключе нет абсолютных адресов: переход внутри функции
+//// задан числом команд до цели, остальные цели переходов и адреса, собранные из lui/auipc
+//// и следующей команды, - "символом + смещением".
+struct Normalized_Instruction {
+    Instruction inst;
+    uint64_t key;
+    bool has_target;
+    uint64_t target;
+};
+
+static bool writes_rd(const Instruction& inst) {
+    switch (inst.format) {
+        case Format::R:
+        case Format::I:
+        case Format::LOAD:
+        case Format::SHIFT:
+        case Format::U:
+        case Format::J:
+        case Format::UNARY:
+        case Format::CSR:
+        case Format::CSR_IMM:
+        case Format::LR:
+        case Format::AMO:
+        case Format::F_XF:
+        case Format::F_XF_RM:
+        case Format::F_XFF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static std::vector<Normalized_Instruction> normalize(const Diff_Image& image, const Diff_Function& function) {
+    std::vector<Normalized_Instruction> result;
+    result.reserve(function.size / 3);
+    for (const Instruction& inst : Instruction_Range(function.bytes, function.size, function.address, image.xlen())) {
+        result.push_back(Normalized_Instruction{inst, 0, false, 0});
+    }
+    auto local_index = [&result](uint64_t address) {
+        auto it = std::lower_bound(result.begin(), result.end(), address,
+                                   [](const Normalized_Instruction& line, uint64_t value) {
+                                       return line.inst.address < value;
+                                   });
+        return it != result.end() && it->inst.address == address ? it - result.begin() : -1;
+    };
+
+    //// Значения регистров после lui/auipc, пока их не перезаписали.
+    uint64_t upper[32] = {};
+    uint32_t known = 0;
+    for (size_t index = 0; index < result.size(); index++) {
+        const Instruction& inst = result[index].inst;
+        uint64_t key = (uint64_t) inst.mnemonic | (uint64_t) inst.rd << 16 | (uint64_t) inst.rs1 << 24 |
+                       (uint64_t) inst.rs2 << 32 | (uint64_t) inst.length << 40;
+        bool has_target = false;
+        uint64_t target = 0;
+        switch (inst.format) {
+            case Format::B:
+            case Format::J:
+                has_target = true;
+                target = inst.address + inst.imm;
+                break;
+            case Format::I:
+            case Format::LOAD:
+            case Format::S:
+            case Format::F_LOAD:
+            case Format::F_STORE:
+                if (known >> inst.rs1 & 1) {
+                    has_target = true;
+                    target = upper[inst.rs1] + inst.imm;
+                }
+                break;
+            default:
+                break;
+        }
+
+        std::string_view name;
+        uint64_t offset;
+        bool local = (inst.format == Format::B || inst.format == Format::J) &&
+                     target - function.address < function.size;
+        bool resolved = has_target && (local || image.resolve(target, name, offset));
+        if (local) {
+            //// Цель не на границе команды: остаётся смещение от самой команды.
+            int64_t target_index = local_index(target);
+            int64_t distance = target_index >= 0 ? target_index - (int64_t) index : inst.imm;
+            key = xxhash64(&distance, sizeof(distance), target_index >= 0 ? ~key : key);
+        }
+        else if (resolved) {
+            key = xxhash64(name, xxhash64(&offset, sizeof(offset), key));
+        }
+        else if (inst.mnemonic != Mnemonic::AUIPC && inst.mnemonic != Mnemonic::LUI) {
+            int64_t imm = inst.imm;
+            key = xxhash64(&imm, sizeof(imm), key);
+            //// rs3, режим округления и aq/rl есть только в коде команды.
+            if (inst.format == Format::LR || inst.format == Format::AMO || inst.format > Format::F_STORE)
+                key = xxhash64(&inst.raw, sizeof(inst.raw), key);
+        }
+        result[index].key = key;
+        result[index].has_target = resolved;
+        result[index].target = target;
+
+        if (writes_rd(inst)) known &= ~(1u << inst.rd);
+        if ((inst.mnemonic == Mnemonic::AUIPC || inst.mnemonic == Mnemonic::LUI) && inst.rd != 0) {
+            upper[inst.rd] = (inst.mnemonic == Mnemonic::AUIPC ? inst.address : 0) + (int64_t) inst.imm;
+            known |= 1u << inst.rd;
+        }
+    }
+    return result;
+}
+
+const size_t DIFF_MAX_COST = 2048;
+
+//// Совпавшие пары (old, new) кратчайшего сценария правки (Myers, O((N + M) * D)).
+//// false, если правок больше max_cost: тогда функция считается переписанной целиком.
+static bool common_subsequence(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, size_t max_cost,
+                               std::vector<std::pair<uint32_t, uint32_t>>& matches) {
+    //// Общие начало и конец не участвуют в поиске.
+    size_t prefix = 0;
+    while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix]) prefix++;
+    size_t suffix = 0;
+    while (suffix < a.size() - prefix && suffix < b.size() - prefix &&
+           a[a.size() - 1 - suffix] == b[b.size() - 1 - suffix]) suffix++;
+    long n = a.size() - prefix - suffix;
+    long m = b.size() - prefix - suffix;
+    const uint64_t* x_seq = a.data() + prefix;
+    const uint64_t* y_seq = b.data() + prefix;
+
+    for (size_t i = 0; i < prefix; i++) matches.emplace_back(i, i);
+    std::vector<std::pair<uint32_t, uint32_t>> middle;
+    if (n > 0 && m > 0) {
+        long max = std::min<long>(n + m, max_cost);
+        std::vector<long> v(2 * max + 3, 0);
+        long center = max + 1;
+        //// trace[d] - v[-d..d] после шага d.
+        std::vector<std::vector<long>> trace;
+        long d = 0;
+        bool done = false;
+        for (; d <= max && !done; d++) {
+            for (long k = -d; k <= d; k += 2) {
+                long x = k == -d || (k != d && v[center + k - 1] < v[center + k + 1]) ? v[center + k + 1] :
+                         v[center + k - 1] + 1;
+                long y = x - k;
+                while (x < n && y < m && x_seq[x] == y_seq[y]) {
+                    x++;
+                    y++;
+                }
+                v[center + k] = x;
+                if (x >= n && y >= m) done = true;
+            }
+            trace.emplace_back(v.begin() + center - d, v.begin() + center + d + 1);
+        }
+        if (!done) return false;
+
+        long x = n, y = m;
+        for (d = (long) trace.size() - 1; d > 0; d--) {
+            const std::vector<long>& previous = trace[d - 1];
+            long k = x - y;
+            auto at = [&previous, d](long index) { return previous[index + d - 1]; };
+            long k_previous = k == -d || (k != d && at(k - 1) < at(k + 1)) ? k + 1 : k - 1;
+            long x_previous = at(k_previous);
+            long y_previous = x_previous - k_previous;
+            long x_start = k_previous == k + 1 ? x_previous : x_previous + 1;
+            while (x > x_start) {
+                x--;
+                y--;
+                middle.emplace_back(x, y);
+            }
+            x = x_previous;
+            y = y_previous;
+        }
+        while (x > 0 && y > 0) {
+            x--;
+            y--;
+            middle.emplace_back(x, y);
+        }
+        std::reverse(middle.begin(), middle.end());
+    }
+    for (const std::pair<uint32_t, uint32_t>& match : middle) {
+        matches.emplace_back(match.first + prefix, match.second + prefix);
+    }
+    for (size_t i = suffix; i > 0; i--) matches.emplace_back(a.size() - i, b.size() - i);
+    return true;
+}
+
+
+static void write_target(Output_Buffer& output, const Diff_Image& image, const Normalized_Instruction& line) {
+    std::string_view name;
+    uint64_t offset;
+    if (!line.has_target || !image.resolve(line.target, name, offset)) return;
+    output.append(" <");
+    output.append(name);
+    if (offset != 0) {
+        output.append("+0x");
+        output.append_hex(offset, 0);
+    }
+    output.put('>');
+}
+
+static void write_diff_line(Output_Buffer& output, char sign, const Diff_Image& image, const Diff_Function& function,
+                            const Normalized_Instruction& line) {
+    output.put(sign);
+    output.put(' ');
+    output.append_hex(line.inst.address - function.address, 5);
+    output.append(": ");
+    write_instruction(output, line.inst);
+    write_target(output, image, line);
+    output.put('\n');
+}
+
+//// Изменённая функция: заголовок и участки различий без контекста, смещения от начала функции.
+//// false, если после нормализации различий нет.
+static bool write_function_diff(Output_Buffer& output, const Diff_Image& old_image, const Diff_Function& old_function,
+                                const Diff_Image& new_image, const Diff_Function& new_function) {
+    std::vector<Normalized_Instruction> old_lines = normalize(old_image, old_function);
+    std::vector<Normalized_Instruction> new_lines = normalize(new_image, new_function);
+    std::vector<uint64_t> old_keys(old_lines.size()), new_keys(new_lines.size());
+    for (size_t i = 0; i < old_lines.size(); i++) old_keys[i] = old_lines[i].key;
+    for (size_t i = 0; i < new_lines.size(); i++) new_keys[i] = new_lines[i].key;
+    if (old_function.size == new_function.size && old_keys == new_keys) return false;
+
+    std::vector<std::pair<uint32_t, uint32_t>> matches;
+    if (!common_subsequence(old_keys, new_keys, DIFF_MAX_COST, matches)) matches.clear();
+    matches.emplace_back(old_lines.size(), new_lines.size());
+
+    size_t removed = old_lines.size() - (matches.size() - 1);
+    size_t added = new_lines.size() - (matches.size() - 1);
+    output.append("~ ");
+    output.append(old_function.name);
+    output.append(": ");
+    output.append_hex(old_function.address, 8);
+    output.append(" -> ");
+    output.append_hex(new_function.address, 8);
+    output.append(", ");
+    output.append_udec(old_function.size);
+    output.append(" -> ");
+    output.append_udec(new_function.size);
+    output.append(" bytes, -");
+    output.append_udec(removed);
+    output.append(" +");
+    output.append_udec(added);
+    output.put('\n');
+
+    size_t i = 0, j = 0;
+    for (const std::pair<uint32_t, uint32_t>& match : matches) {
+        if (i < match.first || j < match.second) {
+            output.append("@@ -");
+            output.append_hex(i < old_lines.size() ? old_lines[i].inst.address - old_function.address :
+                              old_function.size, 0);
+            output.append(" +");
+            output.append_hex(j < new_lines.size() ? new_lines[j].inst.address - new_function.address :
+                              new_function.size, 0);
+            output.append(" @@\n");
+            for (; i < match.first; i++) write_diff_line(output, '-', old_image, old_function, old_lines[i]);
+            for (; j < match.second; j++) write_diff_line(output, '+', new_image, new_function, new_lines[j]);
+        }
+        i = match.first + 1;
+        j = match.second + 1;
+    }
+    return true;
+}
+
+const size_t DIFF_BATCH = 1024;
+
+static void write_function_entry(Output_Buffer& output, char sign, const Diff_Function& function) {
+    output.put(sign);
+    output.put(' ');
+    output.append(function.name);
+    output.append(": ");
+    output.append_hex(function.address, 8);
+    output.append(", ");
+    output.append_udec(function.size);
+    output.append(" bytes\n");
+}
+
+Diff_Summary write_elf_diff(const std::string& old_file, const std::string& new_file, Output_Buffer& output,
+                            Thread_Pool* pool) {
+    std::unique_ptr<Diff_Image> old_image = std::make_unique<Diff_Image>(old_file);
+    std::unique_ptr<Diff_Image> new_image = std::make_unique<Diff_Image>(new_file);
+    const std::vector<Diff_Function>& old_functions = old_image->functions();
+    const std::vector<Diff_Function>& new_functions = new_image->functions();
+
+    Diff_Summary summary;
+    summary.old_functions = old_functions.size();
+    summary.new_functions = new_functions.size();
+
+    //// Оба списка упорядочены по (имени, номеру): сопоставление слиянием.
+    auto less = [](const Diff_Function& a, const Diff_Function& b) {
+        return a.name != b.name ? a.name < b.name : a.occurrence < b.occurrence;
+    };
+    std::vector<std::pair<const Diff_Function*, const Diff_Function*>> candidates;
+    std::vector<const Diff_Function*> removed, added;
+    size_t i = 0, j = 0;
+    while (i < old_functions.size() || j < new_functions.size()) {
+        if (j == new_functions.size() || (i < old_functions.size() && less(old_functions[i], new_functions[j]))) {
+            removed.push_back(&old_functions[i++]);
+        }
+        else if (i == old_functions.size() || less(new_functions[j], old_functions[i])) {
+            added.push_back(&new_functions[j++]);
+        }
+        else {
+            const Diff_Function& old_function = old_functions[i++];
+            const Diff_Function& new_function = new_functions[j++];
+            if (old_function.size == new_function.size && old_function.hash == new_function.hash &&
+                std::equal(old_function.bytes, old_function.bytes + old_function.size, new_function.bytes)) {
+                summary.identical++;
+            }
+            else {
+                candidates.emplace_back(&old_function, &new_function);
+            }
+        }
+    }
+
+    //// Отчёт идёт в порядке адресов новой сборки; функции с различиями разбираются параллельно.
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.second->address < b.second->address;
+    });
+    output.append("--- ");
+    output.append(old_file);
+    output.append("\n+++ ");
+    output.append(new_file);
+    output.put('\n');
+
+    //// Пачками по DIFF_BATCH функций: в памяти отчёты только одной пачки.
+    std::vector<std::unique_ptr<Output_Buffer>> reports(std::min(candidates.size(), DIFF_BATCH));
+    std::vector<char> differs(reports.size());
+    for (size_t first = 0; first < candidates.size(); first += DIFF_BATCH) {
+        size_t count = std::min(DIFF_BATCH, candidates.size() - first);
+        parallel_for(pool, count, [&](size_t k) {
+            if (!reports[k]) reports[k] = std::make_unique<Output_Buffer>((Output_Sink*) nullptr, 1 << 10);
+            reports[k]->clear();
+            differs[k] = write_function_diff(*reports[k], *old_image, *candidates[first + k].first, *new_image,
+                                             *candidates[first + k].second);
+        });
+        for (size_t k = 0; k < count; k++) {
+            if (!differs[k]) {
+                summary.relocated++;
+                continue;
+            }
+            summary.changed++;
+            output.append_block(reports[k]->view());
+        }
+    }
+    std::sort(added.begin(), added.end(), [](const Diff_Function* a, const Diff_Function* b) {
+        return a->address < b->address;
+    });
+    std::sort(removed.begin(), removed.end(), [](const Diff_Function* a, const Diff_Function* b) {
+        return a->address < b->address;
+    });
+    for (const Diff_Function* function : added) write_function_entry(output, '+', *function);
+    for (const Diff_Function* function : removed) write_function_entry(output, '-', *function);
+    summary.added = added.size();
+    summary.removed = removed.size();
+
+    output.append("\nFunctions: ");
+    output.append_udec(summary.old_functions);
+    output.append(" -> ");
+    output.append_udec(summary.new_functions);
+    output.append(", identical ");
+    output.append_udec(summary.identical);
+    output.append(", relocated ");
+    output.append_udec(summary.relocated);
+    output.append(", changed ");
+    output.append_udec(summary.changed);
+    output.append(", added ");
+    output.append_udec(summary.added);
+    output.append(", removed ");
+    output.append_udec(summary.removed);
+    output.put('\n');
+    return summary;
+}
@@ -0,0 +1,168 @@
+#include "elf_image.h"
+#include "elf_parser.h"
+#include "stats.h"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ELF_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+Elf_Image::Elf_Image(const std::string& filename) {
+    Phase_Timer timer(Stats_Phase::OPEN);
+    if (filename == STDIN_NAME) {
+        load_stream();
+        return;
+    }
+#ifdef ELF_IMAGE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    //// Каталог открывается на чтение, но ifstream вернёт для него размер 2^63 - 1.
+    struct stat st{};
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0)
+        throw DisassemblerException("Unable to open elf file!");
+    //// FIFO и /dev/fd/N (например, <(zcat x.elf.gz)) не перематываются и не имеют длины:
+    //// такой вход читается так же, как stdin.
+    if (!S_ISREG(st.st_mode)) {
+        try {
+            spool_stream(fd);
+        }
+        catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        return;
+    }
+    map_file(fd);
+    close(fd);
+    if (_mapped) return;
+#endif
+    std::ifstream input(filename, std::ios::binary);
+    if (!input)
+        throw DisassemblerException("Unable to open elf file!");
+    input.seekg(0, std::ios::end);
+    std::streamoff length = input.tellg();
+    input.seekg(0, std::ios::beg);
+    if (length > 0) {
+        _buffer.resize(length);
+        input.read((char*) _buffer.data(), length);
+        if (input.gcount() != length)
+            throw DisassemblerException("Unable to read elf file!");
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+}
+
+Elf_Image::Elf_Image(const uint8_t* data, size_t size): _buffer(data, data + size) {
+    _data = _buffer.data();
+    _size = _buffer.size();
+}
+
+void Elf_Image::map_file(int fd) {
+#ifdef ELF_IMAGE_MMAP
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return;
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return;
+    _data = static_cast<const uint8_t*>(p);
+    _size = st.st_size;
+    _mapped = true;
+#endif
+}
+
+//// Вход из канала читается строго вперёд блоками фиксированного размера.
+//// Таблица заголовков секций обычно лежит в конце файла, поэтому прочитанное
+//// складывается во временный файл, который затем отображается в память:
+//// объём занятой памяти процесса не зависит от размера входа.
+void Elf_Image::load_stream() {
+#ifdef ELF_IMAGE_MMAP
+    spool_stream(STDIN_FILENO);
+#else
+    std::vector<char> block(STREAM_BLOCK_SIZE);
+    while (std::cin.read(block.data(), block.size()) || std::cin.gcount() > 0) {
+        _buffer.insert(_buffer.end(), block.data(), block.data() + std::cin.gcount());
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+#endif
+}
+
+#ifdef ELF_IMAGE_MMAP
+void Elf_Image::spool_stream(int fd) {
+    map_file(fd);
+    if (_mapped) return;
+
+    FILE* spool = std::tmpfile();
+    if (!spool)
+        throw DisassemblerException("Unable to create temporary file for the input stream!");
+    std::vector<char> block(STREAM_BLOCK_SIZE);
+    while (true) {
+        ssize_t n = ::read(fd, block.data(), block.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            std::fclose(spool);
+            throw DisassemblerException("Unable to read elf file!");
+        }
+        if (n == 0) break;
+        if (std::fwrite(block.data(), 1, n, spool) != (size_t) n) {
+            std::fclose(spool);
+            throw DisassemblerException("Unable to write temporary file for the input stream!");
+        }
+    }
+    std::fflush(spool);
+    map_file(fileno(spool));
+    std::fclose(spool);
+    if (!_mapped) _data = _buffer.data();
+}
+#endif
+
+Elf_Image::~Elf_Image() {
+#ifdef ELF_IMAGE_MMAP
+    if (_mapped) munmap((void*) _data, _size);
+#endif
+}
+
+size_t Elf_Image::size() const {
+    return _size;
+}
+
+bool Elf_Image::is_mapped() const {
+    return _mapped;
+}
+
+void Elf_Image::release(size_t offset, size_t size) const {
+#ifdef ELF_IMAGE_MMAP
+    if (!_mapped || offset > _size) return;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + size, _size) / page * page;
+    if (begin < end) madvise((void*) (_data + begin), end - begin, MADV_DONTNEED);
+#endif
+}
+
+const uint8_t* Elf_Image::data(size_t offset, size_t size) const {
+    if (offset > _size || size > _size - offset)
+        throw DisassemblerException("Incorrect file format! Data is out of the file bounds.");
+    return _data + offset;
+}
+
+std::string_view Elf_Image::read_string(size_t table_offset, size_t table_size, size_t index) const {
+    const char* table = (const char*) data(table_offset, table_size);
+    if (index >= table_size)
+        throw DisassemblerException("Incorrect file format! String is out of the string table.");
+    const void* end = std::memchr(table + index, '\0', table_size - index);
+    size_t length = end ? (const char*) end - (table + index) : table_size - index;
+    return std::string_view(table + index, length);
+}
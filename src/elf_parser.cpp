@@ -1,10 +1,16 @@
 #include "elf_parser.h"
 #include "disassembler.h"
+#include "instruction_iterator.h"
+#include "binary_format.h"
+#include "hash.h"
+#include "stats.h"
+#include "text_scan.h"
 #include <fstream>
 #include <iostream>
 #include <cstring>
-#include <cmath>
 #include <string>
+#include <algorithm>
+#include <memory>
 
 
 
@@ -15,184 +21,603 @@ std::string DisassemblerException::get_message() const {
 }
 
 
-ELF_Header::ELF_Header(std::ifstream& input) {
-    input.seekg(0, std::ios::end);
-    size_t length = input.tellg();
-    input.seekg(0, std::ios::beg);
-    if (length < E_HEADER_SIZE)
+ELF_Header::ELF_Header(const Elf_Image& image) {
+    Phase_Timer timer(Stats_Phase::HEADER);
+    if (image.size() < E_HEADER_SIZE)
         throw DisassemblerException("Incorrect file format! Size of the ELF Header is too small.");
 
-    char format[E_HEADER_SIZE];
-    input.read(format, E_HEADER_SIZE);
+    const unsigned char* format = image.data(0, EI_NIDENT);
     if (format[0] != EI_MAG0 || format[1] != EI_MAG1 || format[2] != EI_MAG2 || format[3] != EI_MAG3 ||
-        format[4] != ELFCLASS32 || format[5] != ELFDATA2LSB || format[6] != EV_CURRENT)
-        throw DisassemblerException("Incorrect file format! Correct format: ELF file, 32b, LSB");
+        (format[4] != ELFCLASS32 && format[4] != ELFCLASS64) || format[5] != ELFDATA2LSB || format[6] != EV_CURRENT)
+        throw DisassemblerException("Incorrect file format! Correct format: ELF file, 32b or 64b, LSB");
 
-    input.seekg(E_SHOFF_POS, std::ios::beg);
-    input.read((char*) &e_shoff, 4);
+    if (format[4] == ELFCLASS64) read_header<Elf64>(image);
+    else read_header<Elf32>(image);
+}
+
+template<typename Elf>
+void ELF_Header::read_header(const Elf_Image& image) {
+    if (image.size() < sizeof(typename Elf::Header))
+        throw DisassemblerException("Incorrect file format! Size of the ELF Header is too small.");
+    typename Elf::Header header = image.read<typename Elf::Header>(0);
+    _class = Elf::CLASS;
+
+    e_shoff = header.e_shoff;
     if (e_shoff == 0)
         throw DisassemblerException("Incorrect file format! There is no section header table.");
-    input.seekg(E_SINFO_POS, std::ios::beg);
-    input.read((char*) &e_shentsize, 2);
-    input.read((char*) &e_shnum, 2);
-    input.seekg(E_TI_POS, std::ios::beg);
-    input.read((char*) &e_shstrndx, 2);
+    e_shentsize = header.e_shentsize;
+    if (e_shentsize < sizeof(typename Elf::Section_Header))
+        throw DisassemblerException("Incorrect file format! Size of the section header is too small.");
+    e_shnum = header.e_shnum;
+    e_shstrndx = header.e_shstrndx;
+    if (e_shstrndx >= e_shnum)
+        throw DisassemblerException("Incorrect file format! There is no section name string table.");
 }
 
-void ELF_Header::search_sections_info(std::ifstream& input,
+char ELF_Header::elf_class() const {
+    return _class;
+}
+
+Section_Index ELF_Header::section_index(const Elf_Image& image) const {
+    return Section_Index(image, _class, e_shoff, e_shnum, e_shentsize, e_shstrndx);
+}
+
+Section_Info section_info(const Section& section) {
+    if (section.type != SHT_NOBITS && section.size > UINT32_MAX)
+        throw DisassemblerException("Incorrect file format! Section is too large.");
+    Section_Info info;
+    info.sh_offset = section.offset;
+    info.sh_size = section.type == SHT_NOBITS ? 0 : section.size;
+    info.sh_addr = section.addr;
+    info.index = section.index;
+    info.name = section.name;
+    return info;
+}
+
+void ELF_Header::search_sections_info(const Elf_Image& image,
                                       Section_Info& s_i_text,
                                       Section_Info& s_i_symtable,
-                                      Section_Info& shstrtab) const {
-    input.seekg(e_shoff + e_shstrndx * e_shentsize + S_OFFSET_INFO, std::ios::beg);
-    input.read((char*) &shstrtab.sh_offset, 4);
-    input.read((char*) &shstrtab.sh_size, 4);
-
-    uint32_t sh_name;
-    char name[shstrtab.sh_size];
-    for (size_t i = 0; i < e_shnum; i++) {
-        input.seekg(e_shoff + i * e_shentsize, std::ios::beg);
-        input.read((char*) &sh_name, 4);
-        input.seekg(shstrtab.sh_offset + sh_name, std::ios::beg);
-        input.getline(name, shstrtab.sh_size, '\0');
-        if (strcmp(name, ".text") == 0) {
-            input.seekg(e_shoff + i * e_shentsize + S_OFFSET_INFO, std::ios::beg);
-            input.read((char*) &s_i_text.sh_offset, 4);
-            input.read((char*) &s_i_text.sh_size, 4);
-        }
-        if (strcmp(name, ".symtab") == 0) {
-            input.seekg(e_shoff + i * e_shentsize + S_OFFSET_INFO, std::ios::beg);
-            input.read((char*) &s_i_symtable.sh_offset, 4);
-            input.read((char*) &s_i_symtable.sh_size, 4);
-        }
+                                      Section_Info& strtab) const {
+    search_sections_info(section_index(image), s_i_text, s_i_symtable, strtab);
+}
+
+void ELF_Header::search_sections_info(const Section_Index& sections,
+                                      Section_Info& s_i_text,
+                                      Section_Info& s_i_symtable,
+                                      Section_Info& strtab) const {
+    Phase_Timer timer(Stats_Phase::SECTIONS);
+    if (const Section* text = sections.find(".text")) s_i_text = section_info(*text);
+
+    //// Имена символов лежат в таблице строк, на которую ссылается sh_link у .symtab.
+    const Section* names = &sections[e_shstrndx];
+    if (const Section* symtab = sections.find(".symtab")) {
+        s_i_symtable = section_info(*symtab);
+        if (symtab->link != 0 && symtab->link < sections.size()) names = &sections[symtab->link];
     }
+    strtab = section_info(*names);
 }
 
 
-RWer::RWer(Section_Info* s_i_text, Section_Info* s_i_symtable, Section_Info* shstrtab):
+RWer::RWer(Section_Info* s_i_text, Section_Info* s_i_symtable, Section_Info* strtab, char elf_class):
         s_i_text(s_i_text),
         s_i_symtable(s_i_symtable),
-        shstrtab(shstrtab){}
-
-void RWer::processing_symtable(std::ifstream& input, std::ofstream& output) {
-    uint32_t address_name;
-    char s_t[s_i_symtable->sh_size];
-    input.seekg(s_i_symtable->sh_offset, std::ios::beg);
-    input.read(s_t, s_i_symtable->sh_size);
-    for (size_t i = 0; i < (s_i_symtable->sh_size / STR_SYMTAB_SIZE); i++) {
-        Str_Symtab str_sym;
-        char name[shstrtab->sh_size];
-        input.seekg(s_i_symtable->sh_offset + i * STR_SYMTAB_SIZE, std::ios::beg);
-        input.read((char*) &address_name, 4);
-        input.read((char*) &str_sym.value, 4);
-        input.read((char*) &str_sym.size, 4);
-        input.read((char*) &str_sym.info, 1);
-        input.read((char*) &str_sym.other, 1);
-        input.read((char*) &str_sym.index, 2);
-        input.seekg(shstrtab->sh_offset + address_name, std::ios::beg);
-        input.getline(name, shstrtab->sh_size, '\0');
-        str_sym.name = name;
-
-        v_str_symtab.push_back(str_sym);
-        labels[str_sym.value] = str_sym.name;
-    }
-
-}
-
-
-void Str_Symtab::write(std::ofstream& output, size_t i) const {
-    unsigned char type = (info) & 0xf;
-    std::string type_s;
-    if (type == 0) type_s = "NOTYPE";
-    if (type == 1) type_s = "OBJECT";
-    if (type == 2) type_s = "FUNC";
-    if (type == 3) type_s = "SECTION";
-    if (type == 4) type_s = "FILE";
-    if (type == 5) type_s = "COMMON";
-    if (type == 6) type_s = "TLS";
-    if (type == 10) type_s = "LOOS";
-    if (type == 12) type_s = "HIOS";
-    if (type == 13) type_s = "LOPROC";
-    if (type == 15) type_s = "HIPROC";
-
-    unsigned char bind = (info) >> 4;
-    std::string bind_s;
-    if (bind == 0) bind_s = "LOCAL";
-    if (bind == 1) bind_s = "GLOBAL";
-    if (bind == 2) bind_s = "WEAK";
-    if (bind == 10) bind_s = "LOOS";
-    if (bind == 12) bind_s = "HIOS";
-    if (bind == 13) bind_s = "LOPROC";
-    if (bind == 15) bind_s = "HIPROC";
-
-    unsigned char vis = (other) & 0x3;
-    std::string vis_s;
-    if (vis == 0) vis_s = "DEFAULT";
-    if (vis == 1) vis_s = "INTERNAL";
-    if (vis == 2) vis_s = "HIDDEN";
-    if (vis == 3) vis_s = "PROTECTED";
-    if (vis == 4) vis_s = "EXPORTED";
-    if (vis == 5) vis_s = "SINGLETON";
-    if (vis == 6) vis_s = "ELIMINATE";
-
-    std::string index_s;
-    if (index == 0) index_s = "UNDEF";
-    if (index == 0xff00) index_s = "LORESERVE";
-    if (index == 0xff01) index_s = "AFTER";
-    if (index == 0xff02) index_s = "AMD64_LCOMMON";
-    if (index == 0xff1f) index_s = "HIPROC";
-    if (index == 0xff20) index_s = "LOOS";
-    if (index == 0xff3f) index_s = "LOSUNW";
-    if (index == 0xfff1) index_s = "ABS";
-    if (index == 0xfff2) index_s = "COMMON";
-    if (index_s.empty()) index_s = std::to_string(index);
-
-    char str[200];
-    sprintf(str, "[%4i] 0x%-15X %5i %-8s %-8s %-8s %6s %s\n",
-            i, value, size, type_s.data(), bind_s.data(), vis_s.data(), index_s.data(), name.data());
-    output << str;
-}
-
-
-
-void RWer::processing_text(std::ifstream& input, std::ofstream& output) {
-    output.write(".text\n", 6);
-
-    uint32_t big_inst;
-    uint16_t small_inst;
-    uint8_t indicator;
-    input.seekg(s_i_text->sh_offset, std::ios::beg);
-    uint32_t remainder = 0;
-    while (remainder != s_i_text->sh_size) {
-        input.read((char*) &indicator, 1);
-        input.seekg(-1, std::ios::cur);
-        if (get_bits(indicator, 0, 2) == 3) {
-            remainder += BIG_INST_SIZE;
-            input.read((char*) &big_inst, BIG_INST_SIZE);
-            write_big_instruction(output, remainder - BIG_INST_SIZE, big_inst, labels[remainder - BIG_INST_SIZE]);
-        }
-        else {
-            remainder += SMALL_INST_SIZE;
-            input.read((char*) &small_inst, SMALL_INST_SIZE);
-            //// Пока непонятно, откуда брать инфу по сжатым командам.
+        strtab(strtab),
+        elf_class(elf_class){}
+
+Xlen RWer::xlen() const {
+    return elf_class == ELFCLASS64 ? Xlen::RV64 : Xlen::RV32;
+}
+
+template<typename Elf>
+void RWer::load_symbols(const Elf_Image& image) {
+    using Symbol = typename Elf::Symbol;
+    Elf_Table<Symbol> table(image, s_i_symtable->sh_offset, s_i_symtable->sh_size / sizeof(Symbol));
+    symbols.reserve(table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        Symbol symbol = table[i];
+        if (symbol.st_name >= symbols.strtab_size && symbol.st_name != 0)
+            throw DisassemblerException("Incorrect file format! Name of symbol " + std::to_string(i) +
+                                        " is out of the string table.");
+        symbols.values.push_back(symbol.st_value);
+        symbols.sizes.push_back(symbol.st_size);
+        symbols.infos.push_back(symbol.st_info);
+        symbols.others.push_back(symbol.st_other);
+        symbols.indices.push_back(symbol.st_shndx);
+        symbols.name_offsets.push_back(symbol.st_name);
+    }
+}
+
+void RWer::processing_symtable(const Elf_Image& image) {
+    Phase_Timer timer(Stats_Phase::SYMTABLE);
+    symbols.strtab = (const char*) image.data(strtab->sh_offset, strtab->sh_size);
+    symbols.strtab_size = strtab->sh_size;
+    if (elf_class == ELFCLASS64) load_symbols<Elf64>(image);
+    else load_symbols<Elf32>(image);
+
+    //// Номера символов, упорядоченные по секции: метки секции берутся отрезком за O(log n).
+    by_section.resize(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) by_section[i] = i;
+    std::stable_sort(by_section.begin(), by_section.end(), [this](uint32_t a, uint32_t b) {
+        return symbols.indices[a] < symbols.indices[b];
+    });
+    build_labels();
+}
+
+std::vector<uint32_t> RWer::section_symbols() const {
+    return section_symbols(s_i_text->index);
+}
+
+std::vector<uint32_t> RWer::section_symbols(uint32_t index) const {
+    if (index == 0) {
+        std::vector<uint32_t> all(symbols.size());
+        for (size_t i = 0; i < all.size(); i++) all[i] = i;
+        return all;
+    }
+    auto first = std::partition_point(by_section.begin(), by_section.end(), [this, index](uint32_t i) {
+        return symbols.indices[i] < index;
+    });
+    auto last = std::partition_point(first, by_section.end(), [this, index](uint32_t i) {
+        return symbols.indices[i] <= index;
+    });
+    return std::vector<uint32_t>(first, last);
+}
+
+Label_Index RWer::section_labels(uint32_t index) const {
+    Label_Index result;
+    std::vector<uint32_t> numbers = section_symbols(index);
+    result.reserve(numbers.size());
+    for (uint32_t i : numbers) result.add(symbols.values[i], symbols.name(i));
+    result.build();
+    return result;
+}
+
+void RWer::build_labels(const Control_Flow_Graph* cfg) {
+    labels = Label_Index();
+    std::vector<uint32_t> numbers = section_symbols();
+    std::vector<uint64_t> targets;
+    if (cfg) targets = cfg->targets();
+    labels.reserve(numbers.size() + targets.size());
+    //// Символы добавляются после синтетических меток и при совпадении адреса остаются они.
+    char buffer[20];
+    for (uint64_t target : targets) labels.add(target, synthetic_label(target, buffer));
+    for (uint32_t i : numbers) labels.add(symbols.values[i], symbols.name(i));
+    labels.build();
+    labels_section = s_i_text->index;
+    annotate_targets = cfg != nullptr;
+}
+
+Control_Flow_Graph RWer::analyze_control_flow(const Elf_Image& image, Thread_Pool* pool, bool synthesize_labels) {
+    Phase_Timer timer(Stats_Phase::CFG);
+    if (labels_section != s_i_text->index) build_labels();
+    std::vector<uint32_t> entries;
+    for (uint32_t i : section_symbols()) {
+        if ((symbols.infos[i] & 0xf) != STT_FUNC || symbols.values[i] < s_i_text->sh_addr) continue;
+        uint64_t offset = symbols.values[i] - s_i_text->sh_addr;
+        if (offset < s_i_text->sh_size) entries.push_back(offset);
+    }
+    const uint8_t* text = image.data(s_i_text->sh_offset, s_i_text->sh_size);
+    Control_Flow_Graph cfg = build_control_flow(text, s_i_text->sh_size, s_i_text->sh_addr, xlen(),
+                                                std::move(entries), pool);
+    if (synthesize_labels) build_labels(&cfg);
+    return cfg;
+}
+
+
+void Symbol_Table::reserve(size_t count) {
+    values.reserve(count);
+    sizes.reserve(count);
+    infos.reserve(count);
+    others.reserve(count);
+    indices.reserve(count);
+    name_offsets.reserve(count);
+}
+
+size_t Symbol_Table::size() const {
+    return values.size();
+}
+
+std::string_view Symbol_Table::name(size_t i) const {
+    size_t offset = name_offsets[i];
+    if (offset >= strtab_size) return {};
+    const void* end = std::memchr(strtab + offset, '\0', strtab_size - offset);
+    size_t length = end ? (const char*) end - (strtab + offset) : strtab_size - offset;
+    return std::string_view(strtab + offset, length);
+}
+
+
+static const std::string_view SYMBOL_TYPES[16] = {
+        "NOTYPE", "OBJECT", "FUNC", "SECTION", "FILE", "COMMON", "TLS", "",
+        "", "", "LOOS", "", "HIOS", "LOPROC", "", "HIPROC"
+};
+
+static const std::string_view SYMBOL_BINDS[16] = {
+        "LOCAL", "GLOBAL", "WEAK", "", "", "", "", "",
+        "", "", "LOOS", "", "HIOS", "LOPROC", "", "HIPROC"
+};
+
+static const std::string_view SYMBOL_VISIBILITIES[4] = {
+        "DEFAULT", "INTERNAL", "HIDDEN", "PROTECTED"
+};
+
+static std::string_view special_index_name(uint16_t index) {
+    switch (index) {
+        case 0: return "UNDEF";
+        case 0xff00: return "LORESERVE";
+        case 0xff01: return "AFTER";
+        case 0xff02: return "AMD64_LCOMMON";
+        case 0xff1f: return "HIPROC";
+        case 0xff20: return "LOOS";
+        case 0xff3f: return "LOSUNW";
+        case 0xfff1: return "ABS";
+        case 0xfff2: return "COMMON";
+        default: return {};
+    }
+}
+
+void Symbol_Table::write(Output_Buffer& output, size_t i) const {
+    output.put('[');
+    output.append_udec(i, 4);
+    output.append("] 0x");
+    output.pad(16 - output.append_hex(values[i], 0, true));
+    output.append_udec(sizes[i], 5);
+    output.put(' ');
+    output.append_left(SYMBOL_TYPES[infos[i] & 0xf], 8);
+    output.put(' ');
+    output.append_left(SYMBOL_BINDS[infos[i] >> 4], 8);
+    output.put(' ');
+    output.append_left(SYMBOL_VISIBILITIES[others[i] & 0x3], 8);
+    output.put(' ');
+    std::string_view index_s = special_index_name(indices[i]);
+    if (index_s.empty()) output.append_udec(indices[i], 6);
+    else output.append_right(index_s, 6);
+    output.put(' ');
+    output.append(name(i));
+    output.put('\n');
+}
+
+
+
+uint32_t RWer::write_text_range(const uint8_t* text, uint32_t begin, uint32_t end, Output_Buffer& output,
+                                size_t& count) const {
+    Label_Index::Cursor label(labels, s_i_text->sh_addr + begin);
+    Instruction_Stats stats;
+    Instruction_Iterator it(text, end, begin, s_i_text->sh_addr, xlen());
+    for (; it != Instruction_Iterator(); ++it) {
+        write_instruction_line(output, *it, label.at(it->address), annotate_targets ? &label : nullptr);
+        stats.count(*it);
+        count++;
+    }
+    return it.offset();
+}
+
+const Symbol_Table& RWer::symbol_table() const {
+    return symbols;
+}
+
+const Label_Index& RWer::label_index() const {
+    return labels;
+}
+
+//// Функции секции не короче CACHE_MIN_FUNCTION_SIZE, целиком внутри неё, без пересечений.
+std::vector<Function_Range> RWer::function_ranges() const {
+    std::vector<Function_Range> functions;
+    for (uint32_t i : section_symbols()) {
+        if ((symbols.infos[i] & 0xf) != STT_FUNC || symbols.sizes[i] < CACHE_MIN_FUNCTION_SIZE) continue;
+        if (symbols.values[i] < s_i_text->sh_addr) continue;
+        uint64_t begin = symbols.values[i] - s_i_text->sh_addr;
+        uint64_t end = begin + symbols.sizes[i];
+        if (end > s_i_text->sh_size || begin % SMALL_INST_SIZE != 0) continue;
+        functions.push_back(Function_Range{(uint32_t) begin, (uint32_t) end});
+    }
+    std::sort(functions.begin(), functions.end(), [](const Function_Range& a, const Function_Range& b) {
+        return a.begin < b.begin;
+    });
+    size_t out = 0;
+    for (const Function_Range& function : functions) {
+        if (out == 0 || function.begin >= functions[out - 1].end) functions[out++] = function;
+    }
+    functions.resize(out);
+    return functions;
+}
+
+uint32_t RWer::write_function(const uint8_t* text, Function_Range function, Listing_Cache& cache,
+                              Output_Buffer& output, size_t& count) const {
+    uint64_t address = s_i_text->sh_addr + function.begin;
+    //// Текст зависит и от разрядности, и от набора расширений --march.
+    uint64_t seed = ((uint64_t) enabled_extensions() << 33) | (LISTING_CACHE_VERSION * 2 + (xlen() == Xlen::RV64));
+    uint64_t key = xxhash64(text + function.begin, function.end - function.begin, seed);
+    key = labels.hash_range(address, address + (function.end - function.begin), key);
+
+    Cache_Entry entry;
+    if (cache.load(key, entry) && splice_function(entry, address, function.end - function.begin, output)) {
+        stats_add(Stats_Counter::CACHED, entry.lengths.size());
+        count += entry.lengths.size();
+        return function.end;
+    }
+
+    entry.address = address;
+    entry.lengths.clear();
+    Output_Buffer lines((Output_Sink*) nullptr, (function.end - function.begin) * 8);
+    Label_Index::Cursor label(labels, address);
+    Instruction_Stats stats;
+    Instruction_Iterator it(text, function.end, function.begin, s_i_text->sh_addr, xlen());
+    for (; it != Instruction_Iterator(); ++it) {
+        write_instruction_line(lines, *it, label.at(it->address));
+        stats.count(*it);
+        entry.lengths.push_back(it->length);
+    }
+    output.append_block(lines.view());
+    count += entry.lengths.size();
+    if (it.offset() == function.end) {
+        entry.lines = lines.view();
+        cache.store(key, entry);
+    }
+    return it.offset();
+}
+
+//// Метки входят в ключ, поэтому совпадают; отличаться может только адрес начала.
+bool RWer::splice_function(const Cache_Entry& entry, uint64_t address, uint32_t size, Output_Buffer& output) const {
+    size_t total = 0;
+    for (uint8_t length : entry.lengths) total += length;
+    if (total != size) return false;
+    if (entry.address == address) {
+        output.append_block(entry.lines);
+        return true;
+    }
+
+    std::string_view lines = entry.lines;
+    if ((size_t) std::count(lines.begin(), lines.end(), '\n') != entry.lengths.size()) return false;
+    size_t line = 0;
+    for (uint8_t length : entry.lengths) {
+        size_t next = lines.find('\n', line) + 1;
+        size_t column = lines.find(' ', line);
+        if (column >= next) return false;
+        output.append_hex(address, 8);
+        output.append(lines.substr(column, next - column));
+        address += length;
+        line = next;
+    }
+    return true;
+}
+
+//// Функции, начинающиеся в [begin, end), выводятся целиком, даже если выходят за end.
+uint32_t RWer::write_text_cached(const uint8_t* text, uint32_t begin, uint32_t end,
+                                 const std::vector<Function_Range>& functions, Listing_Cache& cache,
+                                 Output_Buffer& output, size_t& count) const {
+    auto function = std::lower_bound(functions.begin(), functions.end(), begin,
+                                     [](const Function_Range& range, uint32_t value) {
+                                         return range.begin < value;
+                                     });
+    uint32_t pos = begin;
+    for (; function != functions.end() && function->begin < end; ++function) {
+        if (function->begin < pos) continue;
+        pos = write_text_range(text, pos, function->begin, output, count);
+        //// Начало функции посреди команды: она выводится как обычный код.
+        if (pos != function->begin) continue;
+        pos = write_function(text, *function, cache, output, count);
+    }
+    if (pos >= end) return pos;
+    return write_text_range(text, pos, end, output, count);
+}
+
+//// Границы команд зависят от RVC, поэтому точки разреза берутся из карты начал команд,
+//// которую строит векторный проход по младшим битам полуслов. Внутри функций из кэша не режем.
+static std::vector<uint32_t> split_text(const uint8_t* text, uint32_t size, uint32_t chunk_size,
+                                        const std::vector<Function_Range>& functions) {
+    std::vector<uint32_t> bounds = {0};
+    Start_Cursor starts(text, size);
+    size_t function = 0;
+    uint32_t next = chunk_size;
+    while (true) {
+        uint32_t pos = starts.next(next);
+        if (pos >= size) break;
+        while (function < functions.size() && functions[function].end <= pos) function++;
+        if (function < functions.size() && functions[function].begin < pos) {
+            next = functions[function].end;
+            continue;
         }
+        bounds.push_back(pos);
+        next = pos + chunk_size;
     }
-    output.write("\n", 1);
+    bounds.push_back(size);
+    return bounds;
 }
 
-void RWer::write_symtab(std::ofstream& output) {
-    output.write(".symtab\n", 8);
-    char h_symtab[100];
-    sprintf(h_symtab, "%s %-15s %7s %-8s %-8s %-8s %6s %s\n",
-            "Symbol", "Value", "Size", "Type", "Bind", "Vis", "Index", "Name");
-    output << h_symtab;
+size_t RWer::processing_text(const Elf_Image& image, Output_Buffer& output, Thread_Pool* pool,
+                             Listing_Cache* cache) {
+    Phase_Timer timer(Stats_Phase::TEXT);
+    stats_add(Stats_Counter::TEXT_BYTES, s_i_text->sh_size);
+    output.append(s_i_text->name);
+    output.put('\n');
+
+    if (labels_section != s_i_text->index) build_labels();
+    //// Метки целей зависят от абсолютных адресов, а ключ кэша от них не зависит.
+    if (annotate_targets) cache = nullptr;
+    const uint8_t* text = image.data(s_i_text->sh_offset, s_i_text->sh_size);
+    std::vector<Function_Range> functions;
+    if (cache) functions = function_ranges();
+    auto write_chunk = [this, text, cache, &functions](uint32_t begin, uint32_t end, Output_Buffer& buffer,
+                                                       size_t& count) {
+        if (cache) return write_text_cached(text, begin, end, functions, *cache, buffer, count);
+        return write_text_range(text, begin, end, buffer, count);
+    };
+
+    if (!pool || pool->size() < 2 || s_i_text->sh_size <= TEXT_CHUNK_SIZE) {
+        //// Окнами фиксированного размера: прочитанные страницы .text сразу отдаются системе.
+        size_t count = 0;
+        uint32_t begin = 0;
+        while (begin < s_i_text->sh_size) {
+            uint32_t end = std::min(s_i_text->sh_size, begin + TEXT_CHUNK_SIZE);
+            uint32_t stop = write_chunk(begin, end, output, count);
+            image.release(s_i_text->sh_offset + begin, stop - begin);
+            if (stop == begin) break;
+            begin = stop;
+        }
+        output.put('\n');
+        return count;
+    }
+
+    std::vector<uint32_t> bounds = split_text(text, s_i_text->sh_size, TEXT_CHUNK_SIZE, functions);
+    size_t chunks = bounds.size() - 1;
+    size_t window = std::min(chunks, pool->size() * 2);
+    std::vector<std::unique_ptr<Output_Buffer>> buffers;
+    std::vector<std::future<void>> futures(window);
+    std::vector<size_t> counts(chunks);
+    for (size_t i = 0; i < window; i++) buffers.push_back(std::make_unique<Output_Buffer>());
+
+    size_t submitted = 0;
+    try {
+        for (size_t i = 0; i < chunks; i++) {
+            for (; submitted < chunks && submitted < i + window; submitted++) {
+                Output_Buffer* buffer = buffers[submitted % window].get();
+                uint32_t begin = bounds[submitted];
+                uint32_t end = bounds[submitted + 1];
+                size_t* count = &counts[submitted];
+                futures[submitted % window] = pool->submit([&write_chunk, begin, end, buffer, count] {
+                    write_chunk(begin, end, *buffer, *count);
+                });
+            }
+            pool->wait(futures[i % window]);
+            futures[i % window].get();
+            output.append_block(buffers[i % window]->view());
+            buffers[i % window]->clear();
+        }
+    }
+    catch (...) {
+        for (std::future<void>& future : futures) {
+            if (future.valid()) pool->wait(future);
+        }
+        throw;
+    }
+    output.put('\n');
+
+    size_t count = 0;
+    for (size_t chunk_count : counts) count += chunk_count;
+    return count;
+}
 
-    for (size_t i = 0; i < v_str_symtab.size(); i++) {
-        v_str_symtab[i].write(output, i);
+std::vector<Address_Range> merge_ranges(std::vector<Address_Range> ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const Address_Range& a, const Address_Range& b) {
+        return a.begin < b.begin;
+    });
+    size_t out = 0;
+    for (const Address_Range& range : ranges) {
+        if (range.begin >= range.end) continue;
+        if (out != 0 && range.begin <= ranges[out - 1].end) {
+            ranges[out - 1].end = std::max(ranges[out - 1].end, range.end);
+            continue;
+        }
+        ranges[out++] = range;
     }
+    ranges.resize(out);
+    return ranges;
 }
 
+std::vector<Address_Range> RWer::symbol_ranges(const std::vector<std::string>& names) const {
+    std::vector<std::string_view> symbol_names(symbols.size());
+    std::vector<uint32_t> by_name(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) {
+        symbol_names[i] = symbols.name(i);
+        by_name[i] = i;
+    }
+    std::sort(by_name.begin(), by_name.end(), [&symbol_names](uint32_t a, uint32_t b) {
+        return symbol_names[a] < symbol_names[b];
+    });
+
+    //// Конец символа без размера - ближайший следующий символ той же секции.
+    auto next_symbol = [this](uint32_t symbol) {
+        uint16_t index = symbols.indices[symbol];
+        auto first = std::partition_point(by_section.begin(), by_section.end(), [this, index](uint32_t i) {
+            return symbols.indices[i] < index;
+        });
+        uint64_t next = UINT64_MAX;
+        for (auto it = first; it != by_section.end() && symbols.indices[*it] == index; ++it) {
+            if (symbols.values[*it] > symbols.values[symbol]) next = std::min(next, symbols.values[*it]);
+        }
+        return next;
+    };
+
+    std::vector<Address_Range> ranges;
+    for (const std::string& name : names) {
+        auto first = std::lower_bound(by_name.begin(), by_name.end(), name,
+                                      [&symbol_names](uint32_t i, const std::string& value) {
+                                          return symbol_names[i] < value;
+                                      });
+        bool found = false;
+        for (auto it = first; it != by_name.end() && symbol_names[*it] == name; ++it) {
+            unsigned char type = symbols.infos[*it] & 0xf;
+            if (symbols.indices[*it] == 0 || type == STT_SECTION || type == STT_FILE) continue;
+            found = true;
+            uint64_t begin = symbols.values[*it];
+            uint64_t size = symbols.sizes[*it];
+            uint64_t end = size == 0 ? next_symbol(*it) : begin + std::min(size, UINT64_MAX - begin);
+            ranges.push_back(Address_Range{begin, end});
+        }
+        if (!found)
+            throw DisassemblerException("Symbol not found: " + name);
+    }
+    return merge_ranges(std::move(ranges));
+}
 
+size_t RWer::processing_text_ranges(const Elf_Image& image, Output_Buffer& output,
+                                    const std::vector<Address_Range>& ranges) {
+    Phase_Timer timer(Stats_Phase::TEXT);
+    uint64_t section_begin = s_i_text->sh_addr;
+    uint64_t section_end = section_begin + s_i_text->sh_size;
+    const uint8_t* text = nullptr;
+    std::unique_ptr<Sync_Index> sync;
+    size_t count = 0;
+    uint32_t pos = 0;
+    for (const Address_Range& range : ranges) {
+        uint64_t begin = std::max(range.begin, section_begin);
+        uint64_t end = std::min(range.end, section_end);
+        if (begin >= end) continue;
+        if (!sync) {
+            output.append(s_i_text->name);
+            output.put('\n');
+            if (labels_section != s_i_text->index) build_labels();
+            text = image.data(s_i_text->sh_offset, s_i_text->sh_size);
+            sync = std::make_unique<Sync_Index>(s_i_text->sh_size);
+            for (uint32_t i : section_symbols()) {
+                if ((symbols.infos[i] & 0xf) != STT_FUNC || symbols.values[i] < section_begin) continue;
+                sync->add(symbols.values[i] - section_begin);
+            }
+            sync->build();
+        }
 
+        //// Команда предыдущего диапазона могла зайти в этот: продолжаем с места остановки.
+        uint32_t first = begin - section_begin;
+        uint32_t last = end - section_begin;
+        first = first < pos ? pos : sync->next_start(text, first);
+        Label_Index::Cursor label(labels, section_begin + first);
+        Instruction_Stats stats;
+        Instruction_Iterator it(text, s_i_text->sh_size, first, section_begin, xlen());
+        for (; it != Instruction_Iterator() && it.offset() < last; ++it) {
+            write_instruction_line(output, *it, label.at(it->address), annotate_targets ? &label : nullptr);
+            stats.count(*it);
+            count++;
+        }
+        pos = it.offset();
+        stats_add(Stats_Counter::TEXT_BYTES, pos - std::min(pos, first));
+    }
+    if (sync) output.put('\n');
+    return count;
+}
 
+size_t RWer::processing_text_binary(const Elf_Image& image, std::ostream& output) {
+    Phase_Timer timer(Stats_Phase::TEXT);
+    stats_add(Stats_Counter::TEXT_BYTES, s_i_text->sh_size);
+    if (labels_section != s_i_text->index) build_labels();
+    const uint8_t* text = image.data(s_i_text->sh_offset, s_i_text->sh_size);
+    return write_binary_listing(output, text, s_i_text->sh_size, s_i_text->sh_addr, labels, xlen());
+}
 
+void RWer::write_symtab(Output_Buffer& output) {
+    Phase_Timer timer(Stats_Phase::SYMTAB);
+    output.append(".symtab\n");
+    output.append("Symbol Value              Size Type     Bind     Vis       Index Name\n");
 
+    for (size_t i = 0; i < symbols.size(); i++) {
+        symbols.write(output, i);
+    }
+}
@@ -0,0 +1,97 @@
+#include "label_index.h"
+#include "hash.h"
+#include <algorithm>
+
+
+void Label_Index::reserve(size_t count) {
+    _entries.reserve(count);
+}
+
+void Label_Index::add(uint64_t address, std::string_view name) {
+    if (name.empty()) return;
+    _entries.push_back(Entry{address, (uint32_t) _names.size(), (uint32_t) name.size()});
+    _names.append(name);
+}
+
+void Label_Index::build() {
+    std::stable_sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b) {
+        return a.address < b.address;
+    });
+    size_t out = 0;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (i + 1 < _entries.size() && _entries[i + 1].address == _entries[i].address) continue;
+        _entries[out++] = _entries[i];
+    }
+    _entries.resize(out);
+    _entries.shrink_to_fit();
+}
+
+size_t Label_Index::size() const {
+    return _entries.size();
+}
+
+std::string_view Label_Index::names() const {
+    return _names;
+}
+
+uint64_t Label_Index::hash_range(uint64_t begin, uint64_t end, uint64_t seed) const {
+    for (size_t i = lower_bound(begin); i < _entries.size() && _entries[i].address < end; i++) {
+        uint64_t offset = _entries[i].address - begin;
+        seed = xxhash64(&offset, sizeof(offset), seed);
+        seed = xxhash64(name(_entries[i]), seed);
+    }
+    return seed;
+}
+
+size_t Label_Index::lower_bound(uint64_t address) const {
+    return std::lower_bound(_entries.begin(), _entries.end(), address, [](const Entry& entry, uint64_t value) {
+        return entry.address < value;
+    }) - _entries.begin();
+}
+
+std::string_view Label_Index::name(const Entry& entry) const {
+    return std::string_view(_names.data() + entry.name_offset, entry.name_size);
+}
+
+std::string_view Label_Index::find(uint64_t address) const {
+    size_t pos = lower_bound(address);
+    if (pos == _entries.size() || _entries[pos].address != address) return {};
+    return name(_entries[pos]);
+}
+
+Label_Index::Cursor::Cursor(const Label_Index& index, uint64_t start):
+        _index(&index),
+        _pos(index.lower_bound(start)) {}
+
+std::string_view Label_Index::Cursor::find(uint64_t address) const {
+    const std::vector<Entry>& entries = _index->_entries;
+    auto less = [](const Entry& entry, uint64_t value) { return entry.address < value; };
+    size_t first, last;
+    size_t step = 1;
+    if (_pos < entries.size() && entries[_pos].address < address) {
+        first = _pos;
+        while (first + step < entries.size() && entries[first + step].address < address) {
+            first += step;
+            step *= 2;
+        }
+        last = std::min(entries.size(), first + step);
+    }
+    else {
+        last = _pos;
+        while (last >= step && entries[last - step].address >= address) {
+            last -= step;
+            step *= 2;
+        }
+        first = last >= step ? last - step : 0;
+    }
+    size_t pos = std::lower_bound(entries.begin() + first, entries.begin() + last, address, less) - entries.begin();
+    if (pos == entries.size() || entries[pos].address != address) return {};
+    return _index->name(entries[pos]);
+}
+
+std::string_view Label_Index::Cursor::at(uint64_t address) {
+    const std::vector<Entry>& entries = _index->_entries;
+    while (_pos < entries.size() && entries[_pos].address < address) _pos++;
+    if (_pos == entries.size() || entries[_pos].address != address) return {};
+    return _index->name(entries[_pos]);
+}
@@ -0,0 +1,36 @@
+#include "libdisasm.h"
+
+
+Elf_Disassembly::Elf_Disassembly(const std::string& filename):
+        _image(filename),
+        _header(_image),
+        _sections(_header.section_index(_image)),
+        _rw(&_text, &_symtab, &_strtab, _header.elf_class()) {
+    _header.search_sections_info(_sections, _text, _symtab, _strtab);
+    _rw.processing_symtable(_image);
+}
+
+const Elf_Image& Elf_Disassembly::image() const {
+    return _image;
+}
+
+const Section_Index& Elf_Disassembly::sections() const {
+    return _sections;
+}
+
+const Symbol_Table& Elf_Disassembly::symbols() const {
+    return _rw.symbol_table();
+}
+
+std::string_view Elf_Disassembly::label(uint64_t address) const {
+    return _rw.label_index().find(address);
+}
+
+Instruction_Range Elf_Disassembly::instructions() const {
+    return Instruction_Range(_image.data(_text.sh_offset, _text.sh_size), _text.sh_size, _text.sh_addr, _rw.xlen());
+}
+
+Instruction_Range Elf_Disassembly::instructions(const Section& section) const {
+    const uint8_t* data = _sections.data(_image, section);
+    return Instruction_Range(data, data ? section.size : 0, section.addr, _rw.xlen());
+}
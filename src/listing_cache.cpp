@@ -0,0 +1,152 @@
+#include "listing_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+
+static const char CACHE_MAGIC[4] = {'R', 'V', 'L', 'C'};
+
+struct Cache_File_Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t address;
+    uint32_t count;
+    uint32_t lines_size;
+};
+
+static_assert(sizeof(Cache_File_Header) == 32, "Cache_File_Header layout");
+
+
+Listing_Cache::Listing_Cache(std::string directory, uint64_t max_size):
+        _directory(std::move(directory)),
+        _max_size(max_size) {}
+
+const std::string& Listing_Cache::directory() const {
+    return _directory;
+}
+
+//// Файлы раскладываются по 256 подкаталогам по старшему байту ключа.
+std::string Listing_Cache::path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%02x/%016llx", (unsigned) (key >> 56), (unsigned long long) key);
+    return _directory + "/" + name;
+}
+
+bool Listing_Cache::load(uint64_t key, Cache_Entry& entry) const {
+    std::string filename = path(key);
+    std::error_code ec;
+    uint64_t file_size = fs::file_size(filename, ec);
+    if (ec) return false;
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) return false;
+
+    //// Размеры из заголовка сверяются с размером файла до выделения памяти: обрезанная или
+    //// испорченная запись - промах, а не bad_alloc.
+    Cache_File_Header header{};
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+              header.version == LISTING_CACHE_VERSION && header.key == key &&
+              file_size == sizeof(header) + (uint64_t) header.count + header.lines_size;
+    if (ok) {
+        entry.address = header.address;
+        entry.lengths.resize(header.count);
+        entry.lines.resize(header.lines_size);
+        ok = std::fread(entry.lengths.data(), 1, header.count, file) == header.count &&
+             std::fread(entry.lines.data(), 1, header.lines_size, file) == header.lines_size &&
+             std::fgetc(file) == EOF;
+    }
+    std::fclose(file);
+    if (!ok) return false;
+
+    fs::last_write_time(filename, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void Listing_Cache::store(uint64_t key, const Cache_Entry& entry) {
+    std::string filename = path(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(filename).parent_path(), ec);
+
+    //// Пишется во временный файл и переименовывается: читатель никогда не видит обрывок.
+    static const uint64_t salt = std::random_device()();
+    size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string temporary = filename + ".tmp" + std::to_string(salt ^ thread);
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return;
+    Cache_File_Header header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = LISTING_CACHE_VERSION;
+    header.key = key;
+    header.address = entry.address;
+    header.count = entry.lengths.size();
+    header.lines_size = entry.lines.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(entry.lengths.data(), 1, entry.lengths.size(), file) == entry.lengths.size() &&
+              std::fwrite(entry.lines.data(), 1, entry.lines.size(), file) == entry.lines.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        fs::remove(temporary, ec);
+        return;
+    }
+    fs::rename(temporary, filename, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_scanned) {
+        //// Размер кэша считается один раз за процесс, дальше только прибавляется.
+        _scanned = true;
+        _size = 0;
+        for (const fs::directory_entry& file_entry : fs::recursive_directory_iterator(_directory, ec)) {
+            if (file_entry.is_regular_file(ec)) _size += file_entry.file_size(ec);
+        }
+    }
+    else {
+        _size += sizeof(header) + entry.lengths.size() + entry.lines.size();
+    }
+    if (_size > _max_size) evict();
+}
+
+//// Удаляются самые старые записи, пока кэш не станет на четверть меньше лимита,
+//// чтобы не обходить каталог при каждой следующей записи.
+void Listing_Cache::evict() {
+    struct File {
+        fs::file_time_type time;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<File> files;
+    std::error_code ec;
+    _size = 0;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(_directory, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        File file{entry.last_write_time(ec), entry.file_size(ec), entry.path()};
+        _size += file.size;
+        files.push_back(std::move(file));
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+        return a.time < b.time;
+    });
+    uint64_t target = _max_size / 4 * 3;
+    for (const File& file : files) {
+        if (_size <= target) break;
+        if (fs::remove(file.path, ec)) _size -= file.size;
+    }
+}
+
+std::string default_cache_dir() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/lab_03";
+    const char* home = std::getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/lab_03";
+    return {};
+}
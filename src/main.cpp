@@ -1,45 +1,72 @@
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <string>
 #include "elf_parser.h"
+#include "disasm_server.h"
+#include "driver.h"
+#include "options.h"
 
 using std::cin, std::cout, std::cerr, std::endl;
 
+//// Коды возврата как у diff(1): 1 - только «есть различия» в --diff, ошибка в любом режиме - 2.
+const int EXIT_DIFFERENT = 1;
+const int EXIT_ERROR = 2;
+
+
+static void print_stats(const Options& options, std::chrono::steady_clock::time_point start) {
+    if (!options.stats) return;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    write_stats(cerr, options.stats_format, seconds);
+}
 
 int main(int argc, char** argv) {
+    std::ios::sync_with_stdio(false);
+    auto start = std::chrono::steady_clock::now();
     try {
-        if (argc != 3) throw DisassemblerException("Wrong number of arguments!");
-        std::string input_filename = std::string (argv[1]);
-        std::string output_filename = std::string (argv[2]);
-        std::ifstream input(input_filename, std::ios::binary);
-        if (!input) {
-            throw DisassemblerException("Unable to open elf file!");
+        Options options = parse_options(argc, argv);
+        stats_enable(options.stats);
+        set_extensions(options.extensions);
+
+        if (options.serve) {
+            run_server(options.inputs[0], options.memory_limit);
+            return 0;
         }
-        std::ofstream output(output_filename);
-        if (!output) {
-            throw DisassemblerException("Unable to open file for saving result!");
+        if (options.batch) {
+            Thread_Pool pool(options.jobs);
+            size_t failed = run_batch(options, pool);
+            print_stats(options, start);
+            return failed == 0 ? 0 : EXIT_ERROR;
         }
 
-        ELF_Header elf_header(input);
-        Section_Info s_i_text, s_i_symtable, shstrtab;
-        elf_header.search_sections_info(input, s_i_text, s_i_symtable, shstrtab);
-
-        RWer rw(&s_i_text, &s_i_symtable, &shstrtab);
-        rw.processing_symtable(input, output);
-        rw.processing_text(input, output);
-        rw.write_symtab(output);
-
+        std::unique_ptr<Thread_Pool> pool;
+        if (options.jobs > 1) pool = std::make_unique<Thread_Pool>(options.jobs);
+        if (options.diff) {
+            size_t differences = run_diff(options, pool.get());
+            print_stats(options, start);
+            return differences == 0 ? 0 : EXIT_DIFFERENT;
+        }
+        std::unique_ptr<Listing_Cache> cache = open_listing_cache(options);
+        File_Result result = disassemble_file(options.inputs[0], options.inputs[1], options, pool.get(),
+                                              cache.get());
+        print_stats(options, start);
+        if (!result.error.empty()) {
+            cerr << result.error << endl;
+            return EXIT_ERROR;
+        }
     }
     catch (DisassemblerException& e) {
-        cout << e.get_message() << endl;
+        cerr << e.get_message() << endl;
+        return EXIT_ERROR;
     }
     catch (std::bad_alloc& e) {
-        cout << "Unable to allocate memory." << endl;
+        cerr << "Unable to allocate memory." << endl;
+        return EXIT_ERROR;
     }
     catch(std::exception& e) {
-        cout << e.what() << endl;
+        cerr << e.what() << endl;
+        return EXIT_ERROR;
     }
     return 0;
 }
-
-
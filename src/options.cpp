@@ -0,0 +1,204 @@
+#include "options.h"
+#include "elf_parser.h"
+#include <algorithm>
+#include <thread>
+
+
+static std::string option_value(int argc, char** argv, int& i, const std::string& arg, const std::string& name) {
+    if (arg.size() > name.size()) {
+        size_t start = name.size() + (arg[name.size()] == '=' ? 1 : 0);
+        return arg.substr(start);
+    }
+    if (++i == argc) throw DisassemblerException("Missing value after " + name + "!");
+    return argv[i];
+}
+
+static bool is_option(const std::string& arg, const std::string& name) {
+    if (arg.rfind(name, 0) != 0) return false;
+    if (arg.size() == name.size()) return true;
+    return name.size() == 2 || arg[name.size()] == '=';
+}
+
+const uint64_t MIN_BUFFER_SIZE = 4 << 10;
+const uint64_t MAX_BUFFER_SIZE = 1 << 30;
+
+static uint64_t parse_size(const std::string& value) {
+    size_t end = 0;
+    uint64_t size;
+    try {
+        size = std::stoull(value, &end);
+    }
+    catch (std::exception&) {
+        throw DisassemblerException("Wrong size: " + value);
+    }
+    std::string suffix = value.substr(end);
+    if (suffix == "K" || suffix == "k") return size << 10;
+    if (suffix == "M" || suffix == "m") return size << 20;
+    if (suffix == "G" || suffix == "g") return size << 30;
+    if (!suffix.empty())
+        throw DisassemblerException("Wrong size: " + value);
+    return size;
+}
+
+static uint64_t parse_address(const std::string& value) {
+    size_t end = 0;
+    uint64_t address;
+    try {
+        address = std::stoull(value, &end, 0);
+    }
+    catch (std::exception&) {
+        throw DisassemblerException("Wrong address: " + value);
+    }
+    if (end != value.size())
+        throw DisassemblerException("Wrong address: " + value);
+    return address;
+}
+
+//// Больше потоков не ускоряет разбор, а лишь тратит память на стеки.
+const size_t MAX_JOBS = 1024;
+
+static size_t parse_jobs(const std::string& value) {
+    size_t end = 0;
+    unsigned long long jobs = 0;
+    //// stoull молча принимает "-1" (как 2^64 - 1) и "4x" (как 4).
+    bool ok = !value.empty() && value[0] >= '0' && value[0] <= '9';
+    if (ok) {
+        try {
+            jobs = std::stoull(value, &end);
+        }
+        catch (std::exception&) {
+            ok = false;
+        }
+    }
+    if (!ok || end != value.size() || jobs > MAX_JOBS)
+        throw DisassemblerException("Wrong number of threads: " + value);
+    if (jobs == 0) return std::max(1u, std::thread::hardware_concurrency());
+    return jobs;
+}
+
+bool has_address_filter(const Options& options) {
+    return options.start != 0 || options.stop != UINT64_MAX || !options.symbols.empty();
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (is_option(arg, "-j")) {
+            options.jobs = parse_jobs(option_value(argc, argv, i, arg, "-j"));
+        }
+        else if (is_option(arg, "--format")) {
+            std::string value = option_value(argc, argv, i, arg, "--format");
+            if (value == "text") options.format = Output_Format::TEXT;
+            else if (value == "bin") options.format = Output_Format::BIN;
+            else throw DisassemblerException("Unknown output format: " + value);
+        }
+        else if (arg == "--from-bin") {
+            options.from_bin = true;
+        }
+        else if (arg == "--batch") {
+            options.batch = true;
+        }
+        else if (arg == "--diff") {
+            options.diff = true;
+        }
+        else if (arg == "--serve") {
+            options.serve = true;
+        }
+        else if (is_option(arg, "--memory-limit")) {
+            options.memory_limit = parse_size(option_value(argc, argv, i, arg, "--memory-limit"));
+        }
+        else if (is_option(arg, "--manifest")) {
+            options.manifest = option_value(argc, argv, i, arg, "--manifest");
+            options.batch = true;
+        }
+        else if (arg == "--cache") {
+            options.cache = true;
+        }
+        else if (arg == "--no-cache") {
+            options.cache = false;
+        }
+        else if (is_option(arg, "--cache-dir")) {
+            options.cache_dir = option_value(argc, argv, i, arg, "--cache-dir");
+            options.cache = true;
+        }
+        else if (is_option(arg, "--cache-size")) {
+            options.cache_size = parse_size(option_value(argc, argv, i, arg, "--cache-size"));
+        }
+        else if (is_option(arg, "--buffer-size")) {
+            std::string value = option_value(argc, argv, i, arg, "--buffer-size");
+            options.buffer_size = parse_size(value);
+            if (options.buffer_size < MIN_BUFFER_SIZE || options.buffer_size > MAX_BUFFER_SIZE)
+                throw DisassemblerException("Wrong buffer size: " + value);
+        }
+        else if (arg == "--async-write") {
+            options.async_write = true;
+        }
+        else if (arg == "--stats") {
+            options.stats = true;
+        }
+        else if (arg.rfind("--stats=", 0) == 0) {
+            std::string value = arg.substr(8);
+            if (value == "table") options.stats_format = Stats_Format::TABLE;
+            else if (value == "json") options.stats_format = Stats_Format::JSON;
+            else throw DisassemblerException("Unknown stats format: " + value);
+            options.stats = true;
+        }
+        else if (arg == "--labels") {
+            options.labels = true;
+        }
+        else if (is_option(arg, "--cfg-format")) {
+            std::string value = option_value(argc, argv, i, arg, "--cfg-format");
+            if (value == "dot") options.cfg_format = Cfg_Format::DOT;
+            else if (value == "json") options.cfg_format = Cfg_Format::JSON;
+            else throw DisassemblerException("Unknown CFG format: " + value);
+        }
+        else if (is_option(arg, "--cfg")) {
+            options.cfg_file = option_value(argc, argv, i, arg, "--cfg");
+        }
+        else if (is_option(arg, "--march")) {
+            std::string value = option_value(argc, argv, i, arg, "--march");
+            if (!parse_march(value, options.extensions)) throw DisassemblerException("Wrong ISA string: " + value);
+        }
+        else if (is_option(arg, "--start")) {
+            options.start = parse_address(option_value(argc, argv, i, arg, "--start"));
+        }
+        else if (is_option(arg, "--stop")) {
+            options.stop = parse_address(option_value(argc, argv, i, arg, "--stop"));
+        }
+        else if (is_option(arg, "--symbol")) {
+            options.symbols.push_back(option_value(argc, argv, i, arg, "--symbol"));
+        }
+        else if (is_option(arg, "-o")) {
+            options.output_dir = option_value(argc, argv, i, arg, "-o");
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            throw DisassemblerException("Unknown option: " + arg);
+        }
+        else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.serve) {
+        if (options.batch || options.diff || options.format != Output_Format::TEXT || options.from_bin)
+            throw DisassemblerException("Option --serve can't be used with --batch, --diff, --format or --from-bin!");
+        if (options.inputs.size() != 1)
+            throw DisassemblerException("Wrong number of arguments!");
+    }
+    else if (options.diff) {
+        if (options.batch || options.format != Output_Format::TEXT || options.from_bin)
+            throw DisassemblerException("Option --diff can't be used with --batch, --format or --from-bin!");
+        if (options.inputs.size() != 2 && options.inputs.size() != 3)
+            throw DisassemblerException("Wrong number of arguments!");
+    }
+    else if (!options.batch && options.inputs.size() != 2)
+        throw DisassemblerException("Wrong number of arguments!");
+    if (options.batch && !options.cfg_file.empty())
+        throw DisassemblerException("Option --cfg can't be used in batch mode!");
+    if (has_address_filter(options) && (options.format == Output_Format::BIN || options.from_bin))
+        throw DisassemblerException("Options --start, --stop and --symbol need text output!");
+    if (options.start >= options.stop)
+        throw DisassemblerException("Wrong address range: --start must be less than --stop!");
+    return options;
+}
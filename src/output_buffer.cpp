@@ -0,0 +1,84 @@
+#include "output_buffer.h"
+#include "stats.h"
+#include <algorithm>
+#include <charconv>
+
+
+Output_Buffer::Output_Buffer(std::ostream* output, size_t capacity):
+        _stream_sink(output ? std::make_unique<Stream_Sink>(*output) : nullptr),
+        _sink(_stream_sink.get()),
+        _buffer(capacity) {}
+
+Output_Buffer::Output_Buffer(Output_Sink* sink, size_t capacity):
+        _sink(sink),
+        _buffer(capacity) {}
+
+Output_Buffer::~Output_Buffer() {
+    try {
+        flush();
+    }
+    catch (...) {}
+}
+
+void Output_Buffer::grow(size_t count) {
+    if (_sink) {
+        flush();
+        if (count <= _buffer.size()) return;
+    }
+    _buffer.resize(std::max(_buffer.size() * 2, _used + count));
+}
+
+void Output_Buffer::pad(size_t count, char c) {
+    reserve(count);
+    std::char_traits<char>::assign(_buffer.data() + _used, count, c);
+    _used += count;
+}
+
+void Output_Buffer::append_dec(int64_t value) {
+    reserve(20);
+    _used = std::to_chars(_buffer.data() + _used, _buffer.data() + _buffer.size(), value).ptr - _buffer.data();
+}
+
+void Output_Buffer::append_udec(uint64_t value, size_t width) {
+    char digits[20];
+    size_t length = std::to_chars(digits, digits + sizeof(digits), value).ptr - digits;
+    append_right(std::string_view(digits, length), width);
+}
+
+size_t Output_Buffer::append_hex(uint64_t value, size_t min_width, bool upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    size_t width = 1;
+    while (width < 16 && (value >> (4 * width)) != 0) width++;
+    if (width < min_width) width = min_width;
+    reserve(width);
+    char* end = _buffer.data() + _used + width;
+    for (char* p = end; p != _buffer.data() + _used; value >>= 4) *--p = digits[value & 0xf];
+    _used += width;
+    return width;
+}
+
+void Output_Buffer::append_block(std::string_view block) {
+    if (_sink && block.size() >= _buffer.size() / 2) {
+        stats_add(Stats_Counter::BYTES_WRITTEN, _used + block.size());
+        _sink->write(view(), block);
+        _used = 0;
+        return;
+    }
+    append(block);
+}
+
+std::string_view Output_Buffer::view() const {
+    return std::string_view(_buffer.data(), _used);
+}
+
+void Output_Buffer::clear() {
+    _used = 0;
+}
+
+void Output_Buffer::flush() {
+    if (_sink && _used != 0) {
+        stats_add(Stats_Counter::BYTES_WRITTEN, _used);
+        _sink->write_buffer(_buffer, _used);
+    }
+    _used = 0;
+}
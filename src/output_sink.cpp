@@ -0,0 +1,199 @@
+#include "output_sink.h"
+#include "output_buffer.h"
+#include <cerrno>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OUTPUT_SINK_FD 1
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+
+void Output_Sink::write(std::string_view first, std::string_view second) {
+    write(first);
+    write(second);
+}
+
+void Output_Sink::write_buffer(std::vector<char>& buffer, size_t size) {
+    write(std::string_view(buffer.data(), size));
+}
+
+
+Stream_Sink::Stream_Sink(std::ostream& output):
+        _output(&output) {}
+
+Stream_Sink::Stream_Sink(const std::string& filename):
+        _file(std::make_unique<std::ofstream>(filename, std::ios::binary)),
+        _output(_file.get()) {}
+
+void Stream_Sink::write(std::string_view data) {
+    if (!good()) return;
+    _output->write(data.data(), data.size());
+    if (good()) _written += data.size();
+}
+
+void Stream_Sink::flush() {
+    _output->flush();
+}
+
+bool Stream_Sink::good() const {
+    return (bool) *_output;
+}
+
+uint64_t Stream_Sink::written() const {
+    return _written;
+}
+
+
+#ifdef OUTPUT_SINK_FD
+Fd_Sink::Fd_Sink(int fd, bool owned):
+        _fd(fd),
+        _owned(owned) {}
+
+Fd_Sink::~Fd_Sink() {
+    if (_owned) close(_fd);
+}
+
+void Fd_Sink::write(std::string_view data) {
+    while (_good && !data.empty()) {
+        ssize_t n = ::write(_fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            _good = false;
+            return;
+        }
+        _written += n;
+        data.remove_prefix(n);
+    }
+}
+
+//// writev может записать не всё: остаток дописывается обычным write.
+void Fd_Sink::write(std::string_view first, std::string_view second) {
+    if (!_good) return;
+    iovec parts[2] = {{(void*) first.data(), first.size()}, {(void*) second.data(), second.size()}};
+    ssize_t n;
+    do {
+        n = ::writev(_fd, parts, 2);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        _good = false;
+        return;
+    }
+    _written += n;
+    size_t done = n;
+    if (done < first.size()) {
+        write(first.substr(done));
+        write(second);
+    }
+    else {
+        write(second.substr(done - first.size()));
+    }
+}
+
+bool Fd_Sink::good() const {
+    return _good;
+}
+
+uint64_t Fd_Sink::written() const {
+    return _written;
+}
+#endif
+
+
+Async_Sink::Async_Sink(std::unique_ptr<Output_Sink> target):
+        _target(std::move(target)),
+        _thread([this] { run(); }) {}
+
+Async_Sink::~Async_Sink() {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait_idle(lock);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+void Async_Sink::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _changed.wait(lock, [this] { return _busy || _stop; });
+        if (!_busy) return;
+        //// Пока пишется _pending, форматирующий поток заполняет свой буфер и не трогает этот.
+        lock.unlock();
+        _target->write(std::string_view(_pending.data(), _pending_size));
+        lock.lock();
+        _busy = false;
+        _changed.notify_all();
+    }
+}
+
+void Async_Sink::wait_idle(std::unique_lock<std::mutex>& lock) {
+    _changed.wait(lock, [this] { return !_busy; });
+}
+
+void Async_Sink::write(std::string_view data) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait_idle(lock);
+        _pending.assign(data.begin(), data.end());
+        _pending_size = data.size();
+        _busy = true;
+    }
+    _changed.notify_all();
+}
+
+void Async_Sink::write_buffer(std::vector<char>& buffer, size_t size) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait_idle(lock);
+        size_t capacity = buffer.size();
+        std::swap(buffer, _pending);
+        if (buffer.size() < capacity) buffer.resize(capacity);
+        _pending_size = size;
+        _busy = true;
+    }
+    _changed.notify_all();
+}
+
+void Async_Sink::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    wait_idle(lock);
+    _target->flush();
+}
+
+//// Состояние цели читается только между записями.
+bool Async_Sink::good() const {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [this] { return !_busy; });
+    return _target->good();
+}
+
+uint64_t Async_Sink::written() const {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [this] { return !_busy; });
+    return _target->written();
+}
+
+
+std::unique_ptr<Output_Sink> open_output_sink(const std::string& filename, bool async) {
+    std::unique_ptr<Output_Sink> sink;
+#ifdef OUTPUT_SINK_FD
+    if (filename == STDOUT_NAME) {
+        sink = std::make_unique<Fd_Sink>(STDOUT_FILENO);
+    }
+    else {
+        int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return nullptr;
+        sink = std::make_unique<Fd_Sink>(fd, true);
+    }
+#else
+    if (filename == STDOUT_NAME) sink = std::make_unique<Stream_Sink>(std::cout);
+    else sink = std::make_unique<Stream_Sink>(filename);
+    if (!sink->good()) return nullptr;
+#endif
+    if (async) sink = std::make_unique<Async_Sink>(std::move(sink));
+    return sink;
+}
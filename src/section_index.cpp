@@ -0,0 +1,100 @@
+#include "section_index.h"
+#include "elf_parser.h"
+#include "stats.h"
+
+
+Section_Index::Section_Index(const Elf_Image& image, char elf_class, uint64_t shoff, uint16_t shnum,
+                             uint16_t shentsize, uint16_t shstrndx) {
+    Phase_Timer timer(Stats_Phase::SECTIONS);
+    if (elf_class == ELFCLASS64) load<Elf64>(image, shoff, shnum, shentsize, shstrndx);
+    else load<Elf32>(image, shoff, shnum, shentsize, shstrndx);
+}
+
+static bool in_bounds(const Elf_Image& image, uint64_t offset, uint64_t size) {
+    return offset <= image.size() && size <= image.size() - offset;
+}
+
+static std::string section_label(size_t index, std::string_view name) {
+    std::string label = "Section " + std::to_string(index);
+    if (!name.empty()) label += " (" + std::string(name) + ")";
+    return label;
+}
+
+template<typename Elf>
+void Section_Index::load(const Elf_Image& image, uint64_t shoff, uint16_t shnum, uint16_t shentsize,
+                         uint16_t shstrndx) {
+    using Section_Header = typename Elf::Section_Header;
+    if (!in_bounds(image, shoff, (uint64_t) shnum * shentsize))
+        throw DisassemblerException("Incorrect file format! Section header table is out of the file bounds.");
+    Elf_Table<Section_Header> table(image, shoff, shnum, shentsize);
+    Section_Header shstrtab = table[shstrndx];
+    if (shstrtab.sh_type == SHT_NOBITS || !in_bounds(image, shstrtab.sh_offset, shstrtab.sh_size))
+        throw DisassemblerException("Incorrect file format! Section name string table is out of the file bounds.");
+    const char* names = (const char*) image.data(shstrtab.sh_offset, shstrtab.sh_size);
+
+    //// Границы всех секций проверяются здесь, за один проход по таблице: дальше содержимое
+    //// берётся без проверок, а неверный файл отвергается сразу, с номером и именем секции.
+    _sections.reserve(table.size());
+    _names.reserve(table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        Section_Header header = table[i];
+        if (header.sh_name >= shstrtab.sh_size && header.sh_name != 0)
+            throw DisassemblerException("Incorrect file format! Name of section " + std::to_string(i) +
+                                        " is out of the section name string table.");
+        std::string_view name;
+        if (header.sh_name < shstrtab.sh_size) {
+            const char* begin = names + header.sh_name;
+            const void* end = std::memchr(begin, '\0', shstrtab.sh_size - header.sh_name);
+            name = std::string_view(begin, end ? (const char*) end - begin : shstrtab.sh_size - header.sh_name);
+        }
+        if (header.sh_type != SHT_NOBITS && !in_bounds(image, header.sh_offset, header.sh_size))
+            throw DisassemblerException("Incorrect file format! " + section_label(i, name) +
+                                        " is out of the file bounds.");
+        _sections.push_back(Section{name, (uint32_t) i, header.sh_type, header.sh_flags, header.sh_addr,
+                                    header.sh_offset, header.sh_size, header.sh_link, header.sh_info,
+                                    header.sh_entsize});
+        if (!name.empty()) _names.emplace(name, (uint32_t) i);
+    }
+}
+
+size_t Section_Index::size() const {
+    return _sections.size();
+}
+
+const Section& Section_Index::operator[](size_t i) const {
+    return _sections[i];
+}
+
+const Section* Section_Index::find(std::string_view name) const {
+    auto it = _names.find(name);
+    return it == _names.end() ? nullptr : &_sections[it->second];
+}
+
+std::vector<const Section*> Section_Index::with_type(uint32_t type) const {
+    std::vector<const Section*> result;
+    for (const Section& section : _sections) {
+        if (section.type == type) result.push_back(&section);
+    }
+    return result;
+}
+
+std::vector<const Section*> Section_Index::with_flags(uint32_t flags) const {
+    std::vector<const Section*> result;
+    for (const Section& section : _sections) {
+        if ((section.flags & flags) == flags) result.push_back(&section);
+    }
+    return result;
+}
+
+std::vector<const Section*> Section_Index::executable() const {
+    std::vector<const Section*> result;
+    for (const Section& section : _sections) {
+        if ((section.flags & SHF_EXECINSTR) && section.type != SHT_NOBITS) result.push_back(&section);
+    }
+    return result;
+}
+
+const uint8_t* Section_Index::data(const Elf_Image& image, const Section& section) const {
+    if (section.type == SHT_NOBITS) return nullptr;
+    return image.data(section.offset, section.size);
+}
@@ -0,0 +1,119 @@
+#include "server_protocol.h"
+#include "elf_parser.h"
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SERVER_PROTOCOL_FD 1
+#include <unistd.h>
+#endif
+
+
+static void put_le(std::string& data, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) data.push_back((char) (value >> (8 * i)));
+}
+
+static uint64_t get_le(std::string_view data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < data.size(); i++) value |= (uint64_t) (uint8_t) data[i] << (8 * i);
+    return value;
+}
+
+
+void Message_Writer::put_u8(uint8_t value) {
+    put_le(_data, value, 1);
+}
+
+void Message_Writer::put_u32(uint32_t value) {
+    put_le(_data, value, 4);
+}
+
+void Message_Writer::put_u64(uint64_t value) {
+    put_le(_data, value, 8);
+}
+
+void Message_Writer::put_string(std::string_view value) {
+    put_u32(value.size());
+    _data.append(value);
+}
+
+std::string_view Message_Writer::frame() {
+    uint64_t size = _data.size() - FRAME_HEADER_SIZE;
+    for (size_t i = 0; i < FRAME_HEADER_SIZE; i++) _data[i] = (char) (size >> (8 * i));
+    return _data;
+}
+
+
+Message_Reader::Message_Reader(std::string_view data):
+        _data(data) {}
+
+std::string_view Message_Reader::take(size_t size) {
+    if (size > _data.size()) throw DisassemblerException("Wrong message: unexpected end!");
+    std::string_view part = _data.substr(0, size);
+    _data.remove_prefix(size);
+    return part;
+}
+
+uint8_t Message_Reader::get_u8() {
+    return get_le(take(1));
+}
+
+uint32_t Message_Reader::get_u32() {
+    return get_le(take(4));
+}
+
+uint64_t Message_Reader::get_u64() {
+    return get_le(take(8));
+}
+
+std::string_view Message_Reader::get_string() {
+    return take(get_u32());
+}
+
+bool Message_Reader::done() const {
+    return _data.empty();
+}
+
+
+uint32_t frame_size(const char* header) {
+    return get_le(std::string_view(header, FRAME_HEADER_SIZE));
+}
+
+#ifdef SERVER_PROTOCOL_FD
+bool write_frame(int fd, std::string_view frame) {
+    while (!frame.empty()) {
+        ssize_t n = ::write(fd, frame.data(), frame.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        frame.remove_prefix(n);
+    }
+    return true;
+}
+
+static bool read_exact(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool read_frame(int fd, std::string& payload, size_t max_size) {
+    char header[FRAME_HEADER_SIZE];
+    if (!read_exact(fd, header, FRAME_HEADER_SIZE)) return false;
+    uint32_t size = frame_size(header);
+    if (size > max_size) return false;
+    payload.resize(size);
+    return read_exact(fd, payload.data(), size);
+}
+#else
+bool write_frame(int, std::string_view) {
+    return false;
+}
+
+bool read_frame(int, std::string&, size_t) {
+    return false;
+}
+#endif
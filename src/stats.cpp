@@ -0,0 +1,103 @@
+#include "stats.h"
+
+#if DISASM_STATS
+#include <atomic>
+#include <cstdio>
+#include <string_view>
+
+
+static std::atomic<bool> enabled{false};
+static std::atomic<uint64_t> counters[(size_t) Stats_Counter::COUNT];
+static std::atomic<uint64_t> phase_times[(size_t) Stats_Phase::COUNT];
+
+static const std::string_view PHASE_NAMES[] = {
+        "open", "header", "sections", "symtable", "cfg", "text", "symtab", "output"
+};
+
+static const std::string_view COUNTER_NAMES[] = {
+        "format_r", "format_i", "format_s", "format_b", "format_u", "format_j", "csr", "atomic", "float", "rvc", "unknown_command",
+        "cached", "text_bytes", "bytes_read", "bytes_written", "allocations", "allocated_bytes", "files"
+};
+
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == (size_t) Stats_Phase::COUNT, "phase names");
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == (size_t) Stats_Counter::COUNT, "counter names");
+
+void stats_enable(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool stats_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void stats_add(Stats_Counter counter, uint64_t value) {
+    if (!stats_enabled()) return;
+    counters[(size_t) counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void stats_add_time(Stats_Phase phase, uint64_t nanoseconds) {
+    phase_times[(size_t) phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+Instruction_Stats::~Instruction_Stats() {
+    if (!_enabled) return;
+    for (size_t i = 0; i < sizeof(_counts) / sizeof(_counts[0]); i++) {
+        if (_counts[i] != 0) counters[i].fetch_add(_counts[i], std::memory_order_relaxed);
+    }
+}
+
+static uint64_t counter(Stats_Counter c) {
+    return counters[(size_t) c].load(std::memory_order_relaxed);
+}
+
+void write_stats(std::ostream& output, Stats_Format format, double seconds) {
+    uint64_t instructions = 0;
+    for (size_t i = 0; i <= (size_t) Stats_Counter::UNKNOWN; i++) instructions += counters[i].load();
+    instructions += counter(Stats_Counter::CACHED);
+    double text_seconds = phase_times[(size_t) Stats_Phase::TEXT].load() / 1e9;
+    double mb_read = counter(Stats_Counter::BYTES_READ) / 1e6;
+    double mb_text = counter(Stats_Counter::TEXT_BYTES) / 1e6;
+    double input_rate = seconds > 0 ? mb_read / seconds : 0;
+    double text_rate = text_seconds > 0 ? mb_text / text_seconds : 0;
+    double instruction_rate = seconds > 0 ? instructions / seconds : 0;
+
+    char line[128];
+    if (format == Stats_Format::JSON) {
+        output << "{\"seconds\": " << seconds << ", \"phases_ms\": {";
+        for (size_t i = 0; i < (size_t) Stats_Phase::COUNT; i++) {
+            std::snprintf(line, sizeof(line), "%s\"%s\": %.3f", i == 0 ? "" : ", ", PHASE_NAMES[i].data(),
+                          phase_times[i].load() / 1e6);
+            output << line;
+        }
+        output << "}, \"counters\": {\"instructions\": " << instructions;
+        for (size_t i = 0; i < (size_t) Stats_Counter::COUNT; i++) {
+            output << ", \"" << COUNTER_NAMES[i] << "\": " << counters[i].load();
+        }
+        std::snprintf(line, sizeof(line), "}, \"input_mb_s\": %.2f, \"text_mb_s\": %.2f, \"instructions_s\": %.0f}\n",
+                      input_rate, text_rate, instruction_rate);
+        output << line;
+        return;
+    }
+
+    output << "Phase              ms      %\n";
+    for (size_t i = 0; i < (size_t) Stats_Phase::COUNT; i++) {
+        double ms = phase_times[i].load() / 1e6;
+        std::snprintf(line, sizeof(line), "%-10s %10.3f %6.1f\n", PHASE_NAMES[i].data(), ms,
+                      seconds > 0 ? ms / 10 / seconds : 0.0);
+        output << line;
+    }
+    std::snprintf(line, sizeof(line), "%-10s %10.3f\n\n", "total", seconds * 1e3);
+    output << line;
+    std::snprintf(line, sizeof(line), "%-16s %14llu\n", "instructions", (unsigned long long) instructions);
+    output << line;
+    for (size_t i = 0; i < (size_t) Stats_Counter::COUNT; i++) {
+        std::snprintf(line, sizeof(line), "%-16s %14llu\n", COUNTER_NAMES[i].data(),
+                      (unsigned long long) counters[i].load());
+        output << line;
+    }
+    std::snprintf(line, sizeof(line), "\nInput: %.2f MB/s, .text: %.2f MB/s, %.0f instructions/s\n",
+                  input_rate, text_rate, instruction_rate);
+    output << line;
+}
+
+#endif
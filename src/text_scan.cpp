@@ -0,0 +1,268 @@
+#include "text_scan.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+
+static inline unsigned lowest_bit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    unsigned n = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+//// Маска длинных команд: бит i, если у полуслова i младшие биты 11.
+//// Маска целыми словами, хвост последнего слова обнулён.
+static void long_mask_scalar(const uint8_t* text, size_t halfwords, uint64_t* mask) {
+    for (size_t word = 0; word * 64 < halfwords; word++) {
+        size_t count = std::min<size_t>(64, halfwords - word * 64);
+        const uint8_t* half = text + word * 128;
+        uint64_t bits = 0;
+        for (size_t i = 0; i < count; i++) bits |= (uint64_t) ((half[2 * i] & 0b11) == 0b11) << i;
+        mask[word] = bits;
+    }
+}
+
+#ifdef TEXT_SCAN_X86
+//// 16 полуслов за шаг: оставить младшие два бита, сравнить с 3, упаковать в байты и снять знаки.
+__attribute__((target("sse2")))
+static void long_mask_sse2(const uint8_t* text, size_t halfwords, uint64_t* mask) {
+    const __m128i low = _mm_set1_epi16(0b11);
+    size_t i = 0;
+    std::memset(mask, 0, (halfwords + 63) / 64 * sizeof(uint64_t));
+    for (; i + 16 <= halfwords; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (text + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*) (text + 2 * i + 16));
+        a = _mm_cmpeq_epi16(_mm_and_si128(a, low), low);
+        b = _mm_cmpeq_epi16(_mm_and_si128(b, low), low);
+        uint64_t bits = (uint16_t) _mm_movemask_epi8(_mm_packs_epi16(a, b));
+        mask[i / 64] |= bits << (i % 64);
+    }
+    for (; i < halfwords; i++) {
+        if ((text[2 * i] & 0b11) == 0b11) mask[i / 64] |= 1ull << (i % 64);
+    }
+}
+
+//// То же по 32 полуслова; packs в AVX2 работает по половинам регистра, отсюда перестановка.
+__attribute__((target("avx2")))
+static void long_mask_avx2(const uint8_t* text, size_t halfwords, uint64_t* mask) {
+    const __m256i low = _mm256_set1_epi16(0b11);
+    size_t i = 0;
+    std::memset(mask, 0, (halfwords + 63) / 64 * sizeof(uint64_t));
+    for (; i + 32 <= halfwords; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (text + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (text + 2 * i + 32));
+        a = _mm256_cmpeq_epi16(_mm256_and_si256(a, low), low);
+        b = _mm256_cmpeq_epi16(_mm256_and_si256(b, low), low);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xd8);
+        uint64_t bits = (uint32_t) _mm256_movemask_epi8(packed);
+        mask[i / 64] |= bits << (i % 64);
+    }
+    for (; i < halfwords; i++) {
+        if ((text[2 * i] & 0b11) == 0b11) mask[i / 64] |= 1ull << (i % 64);
+    }
+}
+#endif
+
+using Long_Mask_Function = void (*)(const uint8_t*, size_t, uint64_t*);
+
+bool scan_isa_supported(Scan_Isa isa) {
+    switch (isa) {
+        case Scan_Isa::BEST:
+        case Scan_Isa::SCALAR:
+            return true;
+#ifdef TEXT_SCAN_X86
+        case Scan_Isa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Scan_Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static Scan_Isa best_isa() {
+    static const Scan_Isa isa = scan_isa_supported(Scan_Isa::AVX2) ? Scan_Isa::AVX2 :
+                                scan_isa_supported(Scan_Isa::SSE2) ? Scan_Isa::SSE2 : Scan_Isa::SCALAR;
+    return isa;
+}
+
+std::string_view scan_isa_name(Scan_Isa isa) {
+    switch (isa == Scan_Isa::BEST ? best_isa() : isa) {
+        case Scan_Isa::SSE2: return "sse2";
+        case Scan_Isa::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+static Long_Mask_Function long_mask_function(Scan_Isa isa) {
+    if (isa == Scan_Isa::BEST) isa = best_isa();
+#ifdef TEXT_SCAN_X86
+    if (isa == Scan_Isa::AVX2 && scan_isa_supported(isa)) return long_mask_avx2;
+    if (isa == Scan_Isa::SSE2 && scan_isa_supported(isa)) return long_mask_sse2;
+#endif
+    return long_mask_scalar;
+}
+
+//// Начала команд по маске длинных команд: полуслово i+1 начинает команду, если
+//// i не начинает длинную. Таблица по 8 полуслов: [маска][перенос] -> 8 бит начал и перенос.
+struct Start_Table {
+    constexpr Start_Table(): entries() {
+        for (unsigned mask = 0; mask < 256; mask++) {
+            for (unsigned carry = 0; carry < 2; carry++) {
+                unsigned starts = 0;
+                bool start = carry;
+                for (unsigned i = 0; i < 8; i++) {
+                    if (start) starts |= 1u << i;
+                    start = !(start && (mask >> i & 1));
+                }
+                entries[mask * 2 + carry] = starts | (start ? 0x100 : 0);
+            }
+        }
+    }
+
+    uint16_t entries[512];
+};
+
+static constexpr Start_Table START_TABLE;
+
+bool scan_instruction_starts(const uint8_t* text, size_t halfwords, bool carry, uint64_t* starts, Scan_Isa isa) {
+    if (halfwords == 0) return carry;
+    long_mask_function(isa)(text, halfwords, starts);
+    size_t words = (halfwords + 63) / 64;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t mask = starts[w];
+        uint64_t result = 0;
+        for (unsigned byte = 0; byte < 8; byte++) {
+            uint16_t entry = START_TABLE.entries[(mask >> (byte * 8) & 0xff) * 2 + carry];
+            result |= (uint64_t) (entry & 0xff) << (byte * 8);
+            carry = entry >> 8;
+        }
+        starts[w] = result;
+    }
+    //// Перенос считается по последнему настоящему полуслову, а не по нулевому хвосту слова.
+    if (halfwords % 64 != 0) {
+        size_t last = halfwords - 1;
+        bool last_start = starts[last / 64] >> (last % 64) & 1;
+        bool last_long = (text[2 * last] & 0b11) == 0b11;
+        carry = !(last_start && last_long);
+        starts[words - 1] &= (1ull << (halfwords % 64)) - 1;
+    }
+    return carry;
+}
+
+
+Start_Cursor::Start_Cursor(const uint8_t* text, size_t size, Scan_Isa isa):
+        _text(text),
+        _size(size),
+        _isa(isa),
+        _starts(SCAN_BLOCK_WORDS) {}
+
+bool Start_Cursor::load_block() {
+    size_t halfwords = _size / 2;
+    if (_block_end >= halfwords) return false;
+    _block_begin = _block_end;
+    _block_end = std::min(halfwords, _block_begin + SCAN_BLOCK_WORDS * 64);
+    _carry = scan_instruction_starts(_text + 2 * _block_begin, _block_end - _block_begin, _carry,
+                                     _starts.data(), _isa);
+    return true;
+}
+
+size_t Start_Cursor::next(size_t offset) {
+    size_t halfword = std::max((offset + 1) / 2, _block_begin);
+    while (halfword >= _block_end) {
+        if (!load_block()) return _size;
+    }
+    while (true) {
+        size_t word = (halfword - _block_begin) / 64;
+        size_t words = (_block_end - _block_begin + 63) / 64;
+        uint64_t bits = _starts[word] & (~0ull << (halfword - _block_begin) % 64);
+        while (bits == 0 && ++word < words) bits = _starts[word];
+        if (bits != 0) return (_block_begin + word * 64 + lowest_bit(bits)) * 2;
+        if (!load_block()) return _size;
+        halfword = _block_begin;
+    }
+}
+
+
+Sync_Index::Sync_Index(size_t size):
+        _size(size) {}
+
+void Sync_Index::add(size_t offset) {
+    if (offset < _size && offset % 2 == 0) _points.push_back(offset);
+}
+
+void Sync_Index::build() {
+    std::sort(_points.begin(), _points.end());
+    _points.erase(std::unique(_points.begin(), _points.end()), _points.end());
+}
+
+size_t Sync_Index::before(size_t offset) const {
+    return *(std::upper_bound(_points.begin(), _points.end(), offset) - 1);
+}
+
+//// Карта строится до полуслова offset включительно: если оно не начало команды,
+//// то предыдущая команда длинная и следующее начало - offset + 2.
+size_t Sync_Index::next_start(const uint8_t* text, size_t offset) const {
+    offset += offset % 2;
+    if (offset >= _size) return _size;
+    size_t point = before(offset);
+    Start_Cursor cursor(text + point, std::min(_size, offset + 2) - point);
+    return std::min(_size, point + cursor.next(offset - point));
+}
+
+Text_Scan::Text_Scan(const uint8_t* text, size_t size, Scan_Isa isa):
+        _text(text),
+        _size(size),
+        _starts((size / 2 + 63) / 64) {
+    scan_instruction_starts(text, size / 2, true, _starts.data(), isa);
+}
+
+size_t Text_Scan::size() const {
+    return _size;
+}
+
+bool Text_Scan::is_start(size_t offset) const {
+    if (offset % 2 != 0 || offset / 2 >= _starts.size() * 64) return false;
+    return _starts[offset / 128] >> (offset / 2 % 64) & 1;
+}
+
+size_t Text_Scan::next_start(size_t offset) const {
+    size_t halfword = (offset + 1) / 2;
+    size_t word = halfword / 64;
+    if (word >= _starts.size()) return _size;
+    uint64_t bits = _starts[word] & (~0ull << (halfword % 64));
+    while (bits == 0) {
+        if (++word == _starts.size()) return _size;
+        bits = _starts[word];
+    }
+    return (word * 64 + lowest_bit(bits)) * 2;
+}
+
+const std::vector<uint64_t>& Text_Scan::starts() const {
+    return _starts;
+}
+
+void Text_Scan::count_opcodes(uint64_t opcodes[128], uint64_t compressed[3]) const {
+    std::memset(opcodes, 0, 128 * sizeof(uint64_t));
+    std::memset(compressed, 0, 3 * sizeof(uint64_t));
+    for (size_t w = 0; w < _starts.size(); w++) {
+        for (uint64_t bits = _starts[w]; bits != 0; bits &= bits - 1) {
+            size_t offset = (w * 64 + lowest_bit(bits)) * 2;
+            uint8_t low = _text[offset];
+            if ((low & 0b11) != 0b11) compressed[low & 0b11]++;
+            else if (_size - offset >= 4) opcodes[low & 0x7f]++;
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+#include <chrono>
+
+
+static thread_local const Thread_Pool* current_pool = nullptr;
+static thread_local size_t current_index = 0;
+
+Thread_Pool::Thread_Pool(size_t threads) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; i++) _queues.push_back(std::make_unique<Worker_Queue>());
+    //// Если поток не создался, уже запущенные нужно остановить и дождаться: иначе
+    //// деструктор std::thread для них вызовет std::terminate.
+    try {
+        for (size_t i = 0; i < threads; i++) _threads.emplace_back([this, i] { worker(i); });
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (std::thread& thread : _threads) thread.join();
+        throw;
+    }
+}
+
+Thread_Pool::~Thread_Pool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (std::thread& thread : _threads) thread.join();
+}
+
+size_t Thread_Pool::size() const {
+    return _threads.size();
+}
+
+std::future<void> Thread_Pool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    Worker_Queue& queue = current_pool == this ? *_queues[current_index] : _global;
+    //// _pending растёт до того, как задачу можно забрать из очереди, и под тем же _mutex,
+    //// что и условие ожидания: иначе уменьшение в try_run_one может его обогнать.
+    bool waiting;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending++;
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        queue.tasks.push_back(std::move(packaged));
+        waiting = _waiting > 0;
+    }
+    _cv.notify_one();
+    if (waiting) _done_cv.notify_all();
+    return result;
+}
+
+bool Thread_Pool::try_run_one(size_t index) {
+    std::packaged_task<void()> task;
+    auto pop = [&task](Worker_Queue& queue, bool back) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        if (back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    };
+
+    bool found = pop(*_queues[index], true) || pop(_global, false);
+    for (size_t i = 1; !found && i < _queues.size(); i++) {
+        found = pop(*_queues[(index + i) % _queues.size()], false);
+    }
+    if (!found) return false;
+    _pending--;
+    task();
+    bool waiting;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        waiting = _waiting > 0;
+    }
+    if (waiting) _done_cv.notify_all();
+    return true;
+}
+
+void Thread_Pool::wait(std::future<void>& future) {
+    if (current_pool != this) {
+        future.wait();
+        return;
+    }
+    //// Поток пула, пока ждёт, выполняет задачи; когда их нет - спит до новой задачи
+    //// или до завершения чьей-то (возможно, той, которую ждёт).
+    auto ready = [&future] { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+    while (!ready()) {
+        if (try_run_one(current_index)) continue;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting++;
+        _done_cv.wait(lock, [&] { return _pending > 0 || ready(); });
+        _waiting--;
+    }
+}
+
+void Thread_Pool::worker(size_t index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        if (try_run_one(index)) continue;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return _stop || _pending > 0; });
+        if (_stop && _pending == 0) return;
+    }
+}
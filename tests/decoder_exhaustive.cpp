@@ -0,0 +1,486 @@
+//// Перебор всех 2^32 кодировок 32-битных команд и всех 2^16 сжатых для RV32 и RV64.
+//// Декодер сверяется с эталонной моделью, написанной прямо по таблицам спецификации:
+//// мнемоники и форматы всех команд I, M, A, F, D, Zicsr, Zba и Zbb, поля регистров и
+//// непосредственные значения, развёртка сжатых команд (мнемоника, регистры, значение) для C.
+//// Каждая 256-я команда ещё и печатается, чтобы проверить форматирование.
+////
+//// decoder_exhaustive [--stride N] - N > 1 проверяет каждую N-ю кодировку (быстрый прогон).
+#include "decoder.h"
+#include "disassembler.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+namespace {
+
+using M = Mnemonic;
+using F = Format;
+
+const size_t SHARD_BITS = 24;
+const size_t MAX_REPORTED = 20;
+
+std::mutex report_mutex;
+std::atomic<uint64_t> failures{0};
+
+void report(const char* what, uint32_t raw, Xlen xlen, int64_t got, int64_t want) {
+    if (failures.fetch_add(1) >= MAX_REPORTED) return;
+    std::lock_guard<std::mutex> lock(report_mutex);
+    std::printf("FAIL rv%d %08x: %s = %lld, expected %lld\n", xlen == Xlen::RV64 ? 64 : 32, raw, what,
+                (long long) got, (long long) want);
+}
+
+uint32_t bits(uint32_t raw, int hi, int lo) {
+    return (raw >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+int64_t sign_extend(uint64_t value, int width) {
+    uint64_t sign = 1ull << (width - 1);
+    value &= (sign << 1) - 1;
+    return (int64_t) (value ^ sign) - (int64_t) sign;
+}
+
+//// Значение из битов raw[hi:...] по записи из спецификации, например "11|4|9:8|10|6|7|3:1|5":
+//// старший бит поля команды - первый бит записи.
+uint32_t scatter(uint32_t raw, int hi, const char* layout) {
+    uint32_t value = 0;
+    int pos = hi;
+    while (*layout) {
+        char* end;
+        int from = (int) std::strtol(layout, &end, 10);
+        int to = from;
+        if (*end == ':') to = (int) std::strtol(end + 1, &end, 10);
+        for (int bit = from; bit >= to; bit--) value |= ((raw >> pos--) & 1u) << bit;
+        layout = *end == '|' ? end + 1 : end;
+    }
+    return value;
+}
+
+//// Эталон: мнемоника и формат; UNKNOWN - кодировка не из I, M, A, F, D, Zicsr, Zba, Zbb.
+struct Reference {
+    Mnemonic mnemonic = M::UNKNOWN;
+    Format format = F::NONE;
+};
+
+//// Команды F и D: S при fmt == 0, D при fmt == 1 (биты 26:25); rm 5 и 6 зарезервированы.
+Reference reference_float(uint32_t raw, Xlen xlen) {
+    const bool rv64 = xlen == Xlen::RV64;
+    uint32_t opcode = bits(raw, 6, 0);
+    uint32_t rm = bits(raw, 14, 12);
+    uint32_t fmt = bits(raw, 26, 25);
+    uint32_t rs2 = bits(raw, 24, 20);
+    bool rm_ok = rm != 5 && rm != 6;
+    bool d = fmt == 1;
+    auto op = [d](Mnemonic single, Mnemonic double_) { return d ? double_ : single; };
+
+    if (opcode == 0x07 || opcode == 0x27) {
+        if (rm != 2 && rm != 3) return {};
+        if (opcode == 0x07) return {rm == 2 ? M::FLW : M::FLD, F::F_LOAD};
+        return {rm == 2 ? M::FSW : M::FSD, F::F_STORE};
+    }
+    if (fmt > 1 || (!rm_ok && opcode != 0x53)) return {};
+    switch (opcode) {
+        case 0x43: return {op(M::FMADD_S, M::FMADD_D), F::F_FFFF_RM};
+        case 0x47: return {op(M::FMSUB_S, M::FMSUB_D), F::F_FFFF_RM};
+        case 0x4b: return {op(M::FNMSUB_S, M::FNMSUB_D), F::F_FFFF_RM};
+        case 0x4f: return {op(M::FNMADD_S, M::FNMADD_D), F::F_FFFF_RM};
+        case 0x53: break;
+        default: return {};
+    }
+    switch (bits(raw, 31, 27)) {
+        case 0x00: return rm_ok ? Reference{op(M::FADD_S, M::FADD_D), F::F_FFF_RM} : Reference{};
+        case 0x01: return rm_ok ? Reference{op(M::FSUB_S, M::FSUB_D), F::F_FFF_RM} : Reference{};
+        case 0x02: return rm_ok ? Reference{op(M::FMUL_S, M::FMUL_D), F::F_FFF_RM} : Reference{};
+        case 0x03: return rm_ok ? Reference{op(M::FDIV_S, M::FDIV_D), F::F_FFF_RM} : Reference{};
+        case 0x0b: return rm_ok && rs2 == 0 ? Reference{op(M::FSQRT_S, M::FSQRT_D), F::F_FF_RM} : Reference{};
+        case 0x04: {
+            const Mnemonic ops[3] = {op(M::FSGNJ_S, M::FSGNJ_D), op(M::FSGNJN_S, M::FSGNJN_D),
+                                     op(M::FSGNJX_S, M::FSGNJX_D)};
+            return rm < 3 ? Reference{ops[rm], F::F_FFF} : Reference{};
+        }
+        case 0x05: {
+            const Mnemonic ops[2] = {op(M::FMIN_S, M::FMIN_D), op(M::FMAX_S, M::FMAX_D)};
+            return rm < 2 ? Reference{ops[rm], F::F_FFF} : Reference{};
+        }
+        case 0x14: {
+            const Mnemonic ops[3] = {op(M::FLE_S, M::FLE_D), op(M::FLT_S, M::FLT_D), op(M::FEQ_S, M::FEQ_D)};
+            return rm < 3 ? Reference{ops[rm], F::F_XFF} : Reference{};
+        }
+        case 0x08:
+            //// fcvt.s.d (fmt = S, rs2 = D) и fcvt.d.s (fmt = D, rs2 = S), только при D.
+            if (!rm_ok) return {};
+            if (!d && rs2 == 1) return {M::FCVT_S_D, F::F_FF_RM};
+            if (d && rs2 == 0) return {M::FCVT_D_S, F::F_FF};
+            return {};
+        case 0x18: {
+            const Mnemonic ops[4] = {op(M::FCVT_W_S, M::FCVT_W_D), op(M::FCVT_WU_S, M::FCVT_WU_D),
+                                     op(M::FCVT_L_S, M::FCVT_L_D), op(M::FCVT_LU_S, M::FCVT_LU_D)};
+            if (!rm_ok || rs2 > (rv64 ? 3u : 1u)) return {};
+            return {ops[rs2], F::F_XF_RM};
+        }
+        case 0x1a: {
+            const Mnemonic ops[4] = {op(M::FCVT_S_W, M::FCVT_D_W), op(M::FCVT_S_WU, M::FCVT_D_WU),
+                                     op(M::FCVT_S_L, M::FCVT_D_L), op(M::FCVT_S_LU, M::FCVT_D_LU)};
+            if (!rm_ok || rs2 > (rv64 ? 3u : 1u)) return {};
+            //// Целое из 32 бит переводится в double точно: режим округления не печатается.
+            return {ops[rs2], d && rs2 < 2 ? F::F_FX : F::F_FX_RM};
+        }
+        case 0x1c:
+            if (rs2 != 0) return {};
+            if (rm == 1) return {op(M::FCLASS_S, M::FCLASS_D), F::F_XF};
+            if (rm == 0 && (!d || rv64)) return {op(M::FMV_X_W, M::FMV_X_D), F::F_XF};
+            return {};
+        case 0x1e:
+            if (rs2 != 0 || rm != 0 || (d && !rv64)) return {};
+            return {op(M::FMV_W_X, M::FMV_D_X), F::F_FX};
+        default:
+            return {};
+    }
+}
+
+Reference reference(uint32_t raw, Xlen xlen) {
+    const bool rv64 = xlen == Xlen::RV64;
+    uint32_t opcode = bits(raw, 6, 0);
+    uint32_t funct3 = bits(raw, 14, 12);
+    uint32_t funct7 = bits(raw, 31, 25);
+    uint32_t rs2 = bits(raw, 24, 20);
+    uint32_t imm12 = bits(raw, 31, 20);
+    //// Старшие биты сдвига: funct6 в RV64 (shamt 6 бит), funct7 в RV32.
+    uint32_t shift_top = rv64 ? bits(raw, 31, 26) << 1 : funct7;
+    auto pick = [](const Mnemonic (&table)[8], uint32_t index, Format format) {
+        return Reference{table[index], table[index] == M::UNKNOWN ? F::NONE : format};
+    };
+    const M U = M::UNKNOWN;
+    switch (opcode) {
+        case 0x37: return {M::LUI, F::U};
+        case 0x17: return {M::AUIPC, F::U};
+        case 0x6f: return {M::JAL, F::J};
+        case 0x67: return funct3 == 0 ? Reference{M::JALR, F::I} : Reference{};
+        case 0x63: {
+            const Mnemonic ops[8] = {M::BEQ, M::BNE, U, U, M::BLT, M::BGE, M::BLTU, M::BGEU};
+            return pick(ops, funct3, F::B);
+        }
+        case 0x03: {
+            const Mnemonic ops[8] = {M::LB, M::LH, M::LW, rv64 ? M::LD : U, M::LBU, M::LHU, rv64 ? M::LWU : U, U};
+            return pick(ops, funct3, F::LOAD);
+        }
+        case 0x23: {
+            const Mnemonic ops[8] = {M::SB, M::SH, M::SW, rv64 ? M::SD : U, U, U, U, U};
+            return pick(ops, funct3, F::S);
+        }
+        case 0x13: {
+            const Mnemonic ops[8] = {M::ADDI, U, M::SLTI, M::SLTIU, M::XORI, U, M::ORI, M::ANDI};
+            if (funct3 == 1) {
+                if (shift_top == 0) return {M::SLLI, F::SHIFT};
+                //// Zbb: clz, ctz, cpop, sext.b, sext.h - funct7 0110000 и номер в поле rs2.
+                const Mnemonic unary[8] = {M::CLZ, M::CTZ, M::CPOP, U, M::SEXT_B, M::SEXT_H, U, U};
+                if (funct7 == 0x30 && rs2 < 8) return pick(unary, rs2, F::UNARY);
+                return {};
+            }
+            if (funct3 == 5) {
+                if (shift_top == 0) return {M::SRLI, F::SHIFT};
+                if (shift_top == 0x20) return {M::SRAI, F::SHIFT};
+                if (shift_top == 0x30) return {M::RORI, F::SHIFT};
+                if (imm12 == 0x287) return {M::ORC_B, F::UNARY};
+                if (imm12 == (rv64 ? 0x6b8u : 0x698u)) return {M::REV8, F::UNARY};
+                return {};
+            }
+            return pick(ops, funct3, F::I);
+        }
+        case 0x1b:
+            if (!rv64) return {};
+            if (funct3 == 0) return {M::ADDIW, F::I};
+            if (funct3 == 1 && funct7 == 0) return {M::SLLIW, F::SHIFT};
+            if (funct3 == 1 && bits(raw, 31, 26) == 0x02) return {M::SLLI_UW, F::SHIFT};
+            if (funct3 == 1 && funct7 == 0x30 && rs2 < 3) {
+                const Mnemonic unary[3] = {M::CLZW, M::CTZW, M::CPOPW};
+                return {unary[rs2], F::UNARY};
+            }
+            if (funct3 == 5 && funct7 == 0) return {M::SRLIW, F::SHIFT};
+            if (funct3 == 5 && funct7 == 0x20) return {M::SRAIW, F::SHIFT};
+            if (funct3 == 5 && funct7 == 0x30) return {M::RORIW, F::SHIFT};
+            return {};
+        case 0x33: {
+            const Mnemonic base[8] = {M::ADD, M::SLL, M::SLT, M::SLTU, M::XOR, M::SRL, M::OR, M::AND};
+            const Mnemonic alt[8] = {M::SUB, U, U, U, M::XNOR, M::SRA, M::ORN, M::ANDN};
+            const Mnemonic mul[8] = {M::MUL, M::MULH, M::MULHSU, M::MULHU, M::DIV, M::DIVU, M::REM, M::REMU};
+            const Mnemonic shadd[8] = {U, U, M::SH1ADD, U, M::SH2ADD, U, M::SH3ADD, U};
+            const Mnemonic minmax[8] = {U, U, U, U, M::MIN, M::MINU, M::MAX, M::MAXU};
+            const Mnemonic rotate[8] = {U, M::ROL, U, U, U, M::ROR, U, U};
+            if (funct7 == 0) return pick(base, funct3, F::R);
+            if (funct7 == 0x20) return pick(alt, funct3, F::R);
+            if (funct7 == 1) return pick(mul, funct3, F::R);
+            if (funct7 == 0x10) return pick(shadd, funct3, F::R);
+            if (funct7 == 0x05) return pick(minmax, funct3, F::R);
+            if (funct7 == 0x30) return pick(rotate, funct3, F::R);
+            if (!rv64 && funct7 == 0x04 && funct3 == 4 && rs2 == 0) return {M::ZEXT_H, F::UNARY};
+            return {};
+        }
+        case 0x3b: {
+            if (!rv64) return {};
+            const Mnemonic base[8] = {M::ADDW, M::SLLW, U, U, U, M::SRLW, U, U};
+            const Mnemonic alt[8] = {M::SUBW, U, U, U, U, M::SRAW, U, U};
+            const Mnemonic mul[8] = {M::MULW, U, U, U, M::DIVW, M::DIVUW, M::REMW, M::REMUW};
+            const Mnemonic shadd[8] = {U, U, M::SH1ADD_UW, U, M::SH2ADD_UW, U, M::SH3ADD_UW, U};
+            const Mnemonic rotate[8] = {U, M::ROLW, U, U, U, M::RORW, U, U};
+            if (funct7 == 0) return pick(base, funct3, F::R);
+            if (funct7 == 0x20) return pick(alt, funct3, F::R);
+            if (funct7 == 1) return pick(mul, funct3, F::R);
+            if (funct7 == 0x10) return pick(shadd, funct3, F::R);
+            if (funct7 == 0x30) return pick(rotate, funct3, F::R);
+            if (funct7 == 0x04 && funct3 == 0) return {M::ADD_UW, F::R};
+            if (funct7 == 0x04 && funct3 == 4 && rs2 == 0) return {M::ZEXT_H, F::UNARY};
+            return {};
+        }
+        case 0x0f:
+            if (funct3 == 0) return {M::FENCE, F::I};
+            if (funct3 == 1) return {M::FENCE_I, F::I};
+            return {};
+        case 0x73: {
+            const Mnemonic csr[8] = {U, M::CSRRW, M::CSRRS, M::CSRRC, U, M::CSRRWI, M::CSRRSI, M::CSRRCI};
+            if (funct3 == 0 && funct7 == 0 && rs2 == 0) return {M::ECALL, F::NONE};
+            if (funct3 == 0 && funct7 == 0 && rs2 == 1) return {M::EBREAK, F::NONE};
+            return pick(csr, funct3, funct3 < 4 ? F::CSR : F::CSR_IMM);
+        }
+        case 0x2f: {
+            //// funct5 в порядке lr, sc, amoswap, amoadd, amoxor, amoand, amoor, amomin, amomax, amominu, amomaxu.
+            if (funct3 != 2 && !(funct3 == 3 && rv64)) return {};
+            const uint32_t funct5[11] = {0x02, 0x03, 0x01, 0x00, 0x04, 0x0c, 0x08, 0x10, 0x14, 0x18, 0x1c};
+            const Mnemonic first = funct3 == 2 ? M::LR_W : M::LR_D;
+            for (uint32_t i = 0; i < 11; i++) {
+                if (bits(raw, 31, 27) != funct5[i]) continue;
+                if (i == 0) return rs2 == 0 ? Reference{first, F::LR} : Reference{};
+                return {(Mnemonic) ((uint32_t) first + i), F::AMO};
+            }
+            return {};
+        }
+        default:
+            return reference_float(raw, xlen);
+    }
+}
+
+//// Непосредственное значение по формату; false - формат его не использует.
+bool reference_imm(uint32_t raw, Format format, int64_t& imm) {
+    switch (format) {
+        case F::I:
+        case F::LOAD:
+        case F::F_LOAD:
+            imm = sign_extend(scatter(raw, 31, "11:0"), 12);
+            return true;
+        case F::SHIFT:
+            imm = scatter(raw, 25, "5:0");
+            return true;
+        case F::S:
+        case F::F_STORE:
+            imm = sign_extend(scatter(raw, 31, "11:5") | scatter(raw, 11, "4:0"), 12);
+            return true;
+        case F::B:
+            imm = sign_extend(scatter(raw, 31, "12|10:5") | scatter(raw, 11, "4:1|11"), 13);
+            return true;
+        case F::U:
+            imm = sign_extend(scatter(raw, 31, "31:12"), 32);
+            return true;
+        case F::J:
+            imm = sign_extend(scatter(raw, 31, "20|10:1|11|19:12"), 21);
+            return true;
+        case F::CSR:
+        case F::CSR_IMM:
+            imm = scatter(raw, 31, "11:0");
+            return true;
+        default:
+            return false;
+    }
+}
+
+void check_instruction(uint32_t raw, Xlen xlen, Output_Buffer& output) {
+    Instruction inst = decode_instruction(raw, 0x10000, xlen);
+    Reference want = (raw & 3) == 3 ? reference(raw, xlen) : Reference{};
+    if (inst.mnemonic != want.mnemonic) report("mnemonic", raw, xlen, (int) inst.mnemonic, (int) want.mnemonic);
+    else if (inst.format != want.format) report("format", raw, xlen, (int) inst.format, (int) want.format);
+    if (inst.length != 4) report("length", raw, xlen, inst.length, 4);
+    if (inst.mnemonic == M::UNKNOWN) return;
+
+    if (inst.format >= F::COUNT) report("format", raw, xlen, (int) inst.format, (int) F::COUNT);
+    if (inst.rd != bits(raw, 11, 7)) report("rd", raw, xlen, inst.rd, bits(raw, 11, 7));
+    if (inst.rs1 != bits(raw, 19, 15)) report("rs1", raw, xlen, inst.rs1, bits(raw, 19, 15));
+    if (inst.rs2 != bits(raw, 24, 20)) report("rs2", raw, xlen, inst.rs2, bits(raw, 24, 20));
+    if (inst.format == F::F_FFFF_RM && inst.rs3 != bits(raw, 31, 27)) {
+        report("rs3", raw, xlen, inst.rs3, bits(raw, 31, 27));
+    }
+    int64_t imm = 0;
+    if (reference_imm(raw, inst.format, imm) && inst.imm != imm) report("imm", raw, xlen, inst.imm, imm);
+
+    if ((raw * 0x9e3779b1u) >> 24 == 0) {
+        output.clear();
+        write_instruction(output, inst);
+        if (output.view().empty()) report("text size", raw, xlen, 0, 1);
+    }
+}
+
+//// Эталонная развёртка сжатой команды по таблицам RVC из спецификации.
+struct Expanded {
+    Mnemonic mnemonic = M::UNKNOWN;
+    uint32_t rd = 0;
+    uint32_t rs1 = 0;
+    uint32_t rs2 = 0;
+    int64_t imm = 0;
+};
+
+Expanded reference_compressed(uint32_t c, Xlen xlen) {
+    const bool rv64 = xlen == Xlen::RV64;
+    const uint32_t SP = 2;
+    const uint32_t RA = 1;
+    uint32_t funct3 = bits(c, 15, 13);
+    uint32_t rd = bits(c, 11, 7);
+    uint32_t rs2 = bits(c, 6, 2);
+    uint32_t rd_c = 8 + bits(c, 4, 2);
+    uint32_t rs1_c = 8 + bits(c, 9, 7);
+    int64_t imm6 = sign_extend(scatter(c, 12, "5") | scatter(c, 6, "4:0"), 6);
+    uint32_t shamt = scatter(c, 12, "5") | scatter(c, 6, "4:0");
+    int64_t jump = sign_extend(scatter(c, 12, "11|4|9:8|10|6|7|3:1|5"), 12);
+    int64_t branch = sign_extend(scatter(c, 12, "8|4:3") | scatter(c, 6, "7:6|2:1|5"), 9);
+    uint32_t word = scatter(c, 12, "5:3") | scatter(c, 6, "2|6");
+    uint32_t dword = scatter(c, 12, "5:3") | scatter(c, 6, "7:6");
+    uint32_t word_sp = scatter(c, 12, "5") | scatter(c, 6, "4:2|7:6");
+    uint32_t dword_sp = scatter(c, 12, "5") | scatter(c, 6, "4:3|8:6");
+    uint32_t store_word_sp = scatter(c, 12, "5:2|7:6");
+    uint32_t store_dword_sp = scatter(c, 12, "5:3|8:6");
+
+    //// Ветви в восьмеричной записи: первая цифра - квадрант (биты 1:0), вторая - funct3.
+    switch (bits(c, 1, 0) << 3 | funct3) {
+        case 000: {
+            uint32_t nzuimm = scatter(c, 12, "5:4|9:6|2|3");
+            if (nzuimm == 0) return {};
+            return {M::ADDI, rd_c, SP, 0, nzuimm};
+        }
+        case 001: return {M::FLD, rd_c, rs1_c, 0, dword};
+        case 002: return {M::LW, rd_c, rs1_c, 0, word};
+        case 003: return rv64 ? Expanded{M::LD, rd_c, rs1_c, 0, dword} : Expanded{M::FLW, rd_c, rs1_c, 0, word};
+        case 005: return {M::FSD, 0, rs1_c, rd_c, dword};
+        case 006: return {M::SW, 0, rs1_c, rd_c, word};
+        case 007: return rv64 ? Expanded{M::SD, 0, rs1_c, rd_c, dword} : Expanded{M::FSW, 0, rs1_c, rd_c, word};
+
+        case 010: return {M::ADDI, rd, rd, 0, imm6};
+        case 011:
+            if (!rv64) return {M::JAL, RA, 0, 0, jump};
+            if (rd == 0) return {};
+            return {M::ADDIW, rd, rd, 0, imm6};
+        case 012: return {M::ADDI, rd, 0, 0, imm6};
+        case 013:
+            if (rd == SP) {
+                int64_t nzimm = sign_extend(scatter(c, 12, "9") | scatter(c, 6, "4|6|8:7|5"), 10);
+                if (nzimm == 0) return {};
+                return {M::ADDI, SP, SP, 0, nzimm};
+            }
+            if (imm6 == 0) return {};
+            return {M::LUI, rd, 0, 0, sign_extend(scatter(c, 12, "17") | scatter(c, 6, "16:12"), 18)};
+        case 014:
+            switch (bits(c, 11, 10)) {
+                case 0:
+                case 1:
+                    if (!rv64 && shamt >= 32) return {};
+                    return {bits(c, 11, 10) == 0 ? M::SRLI : M::SRAI, rs1_c, rs1_c, 0, shamt};
+                case 2:
+                    return {M::ANDI, rs1_c, rs1_c, 0, imm6};
+                default: {
+                    const Mnemonic ops[8] = {M::SUB, M::XOR, M::OR, M::AND, M::SUBW, M::ADDW, M::UNKNOWN, M::UNKNOWN};
+                    Mnemonic op = ops[scatter(c, 12, "2") | bits(c, 6, 5)];
+                    if (op == M::UNKNOWN || (!rv64 && bits(c, 12, 12))) return {};
+                    return {op, rs1_c, rs1_c, rd_c, 0};
+                }
+            }
+        case 015: return {M::JAL, 0, 0, 0, jump};
+        case 016: return {M::BEQ, 0, rs1_c, 0, branch};
+        case 017: return {M::BNE, 0, rs1_c, 0, branch};
+
+        case 020:
+            if (!rv64 && shamt >= 32) return {};
+            return {M::SLLI, rd, rd, 0, shamt};
+        case 021: return {M::FLD, rd, SP, 0, dword_sp};
+        case 022:
+            if (rd == 0) return {};
+            return {M::LW, rd, SP, 0, word_sp};
+        case 023:
+            if (!rv64) return {M::FLW, rd, SP, 0, word_sp};
+            if (rd == 0) return {};
+            return {M::LD, rd, SP, 0, dword_sp};
+        case 024:
+            if (bits(c, 12, 12) == 0) {
+                if (rs2 != 0) return {M::ADD, rd, 0, rs2, 0};
+                if (rd == 0) return {};
+                return {M::JALR, 0, rd, 0, 0};
+            }
+            if (rs2 != 0) return {M::ADD, rd, rd, rs2, 0};
+            if (rd == 0) return {M::EBREAK, 0, 0, 0, 0};
+            return {M::JALR, RA, rd, 0, 0};
+        case 025: return {M::FSD, 0, SP, rs2, store_dword_sp};
+        case 026: return {M::SW, 0, SP, rs2, store_word_sp};
+        case 027:
+            if (!rv64) return {M::FSW, 0, SP, rs2, store_word_sp};
+            return {M::SD, 0, SP, rs2, store_dword_sp};
+        default:
+            return {};
+    }
+}
+
+void check_compressed(uint32_t c, Xlen xlen, Output_Buffer& output) {
+    Instruction inst = decode_compressed(c, 0x10000, xlen);
+    Expanded want = reference_compressed(c, xlen);
+    if (inst.length != 2) report("length", c, xlen, inst.length, 2);
+    if (inst.mnemonic != want.mnemonic) {
+        report("compressed mnemonic", c, xlen, (int) inst.mnemonic, (int) want.mnemonic);
+        return;
+    }
+    if (inst.mnemonic == M::UNKNOWN) return;
+    if (inst.format >= F::COUNT) report("format", c, xlen, (int) inst.format, (int) F::COUNT);
+    if (inst.rd != want.rd) report("compressed rd", c, xlen, inst.rd, want.rd);
+    if (inst.rs1 != want.rs1) report("compressed rs1", c, xlen, inst.rs1, want.rs1);
+    if (inst.rs2 != want.rs2) report("compressed rs2", c, xlen, inst.rs2, want.rs2);
+    if (inst.imm != want.imm) report("compressed imm", c, xlen, inst.imm, want.imm);
+    output.clear();
+    write_instruction(output, inst);
+    if (output.view().empty()) report("text size", c, xlen, 0, 1);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    uint64_t stride = 1;
+    if (argc == 3 && std::strcmp(argv[1], "--stride") == 0) stride = std::max(1ull, std::strtoull(argv[2], nullptr, 10));
+    else if (argc != 1) {
+        std::fprintf(stderr, "Usage: decoder_exhaustive [--stride N]\n");
+        return 2;
+    }
+
+    Thread_Pool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (Xlen xlen : {Xlen::RV32, Xlen::RV64}) {
+        const size_t shards = (size_t) 1 << (32 - SHARD_BITS);
+        parallel_for(&pool, shards, [&](size_t shard) {
+            Output_Buffer output((std::ostream*) nullptr, 1 << 10);
+            uint64_t begin = (uint64_t) shard << SHARD_BITS;
+            uint64_t end = begin + (1ull << SHARD_BITS);
+            for (uint64_t raw = (begin + stride - 1) / stride * stride; raw < end; raw += stride) {
+                check_instruction((uint32_t) raw, xlen, output);
+            }
+        });
+        Output_Buffer output((std::ostream*) nullptr, 1 << 10);
+        for (uint32_t c = 0; c < (1u << 16); c++) {
+            if ((c & 3) != 3) check_compressed(c, xlen, output);
+        }
+    }
+
+    uint64_t failed = failures.load();
+    if (failed != 0) {
+        std::printf("%llu mismatches\n", (unsigned long long) failed);
+        return 1;
+    }
+    std::printf("decoder matches the reference model (stride %llu)\n", (unsigned long long) stride);
+    return 0;
+}
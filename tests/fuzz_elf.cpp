@@ -0,0 +1,27 @@
+//// Вход libFuzzer для разбора ELF: заголовок, таблица секций, .symtab и листинг .text.
+//// Любой вход должен заканчиваться либо листингом, либо DisassemblerException.
+////
+//// fuzz_elf corpus/ -max_len=65536   (собирается только Clang с -fsanitize=fuzzer)
+#include "elf_parser.h"
+#include "output_buffer.h"
+#include <cstddef>
+#include <cstdint>
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    try {
+        Elf_Image image(data, size);
+        ELF_Header elf_header(image);
+        Section_Info s_i_text, s_i_symtable, strtab;
+        elf_header.search_sections_info(image, s_i_text, s_i_symtable, strtab);
+
+        RWer rw(&s_i_text, &s_i_symtable, &strtab, elf_header.elf_class());
+        rw.processing_symtable(image);
+        Output_Buffer output((std::ostream*) nullptr);
+        rw.processing_text(image, output);
+        rw.write_symtab(output);
+    }
+    catch (DisassemblerException&) {
+    }
+    return 0;
+}
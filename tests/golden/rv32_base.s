@@ -0,0 +1,48 @@
+.option norelax
+.text
+.globl fib
+.type fib, @function
+fib:
+    li t0, 2
+    blt a0, t0, .Lsmall
+    addi sp, sp, -16
+    sw ra, 12(sp)
+    sw s0, 8(sp)
+    mv s0, a0
+    addi a0, a0, -1
+    call fib
+    sw a0, 4(sp)
+    addi a0, s0, -2
+    call fib
+    lw t1, 4(sp)
+    add a0, a0, t1
+    lw ra, 12(sp)
+    lw s0, 8(sp)
+    addi sp, sp, 16
+.Lsmall:
+    ret
+.size fib, .-fib
+
+.globl ops
+.type ops, @function
+ops:
+    lui a1, 0xfffff
+    srli a2, a1, 31
+    slli a3, a1, 1
+    sub a4, a3, a2
+    xor a5, a4, a1
+    or a5, a5, a2
+    and a5, a5, a3
+    mulh a6, a5, a4
+    mulhsu a6, a5, a4
+    div a7, a6, a5
+    rem a7, a7, a5
+    sb a1, -1(sp)
+    sh a1, -2048(sp)
+    lbu a2, 2047(sp)
+    lh a3, 0(a0)
+    c.j .Lout
+    j ops
+.Lout:
+    jr ra
+.size ops, .-ops
@@ -0,0 +1,80 @@
+.text
+.globl f
+f:
+lr.w a0, (a1)
+sc.w.aq a0, a2, (a1)
+amoswap.w.aqrl a0, a2, (a1)
+amoadd.w a0, a2, (a1)
+amoxor.w a0, a2, (a1)
+amoand.w.rl a0, a2, (a1)
+amoor.w a0, a2, (a1)
+amomin.w a0, a2, (a1)
+amomax.w a0, a2, (a1)
+amominu.w a0, a2, (a1)
+amomaxu.w a0, a2, (a1)
+flw ft0, 8(a0)
+fsw ft1, -4(sp)
+fld fa0, 16(a0)
+fsd fa1, -2048(s0)
+fadd.s ft0, ft1, ft2
+fsub.d fa0, fa1, fa2, rtz
+fmul.s ft0, ft1, ft2, rne
+fdiv.d ft0, ft1, ft2
+fsqrt.s ft3, ft4
+fsqrt.d ft3, ft4, rdn
+fmadd.s fa0, fa1, fa2, fa3
+fmsub.d fa0, fa1, fa2, fa3, rup
+fnmsub.s fa0, fa1, fa2, fa3
+fnmadd.d fa0, fa1, fa2, fa3, rmm
+fsgnj.s ft0, ft1, ft2
+fsgnjn.d ft0, ft1, ft2
+fsgnjx.s ft0, ft1, ft2
+fmin.s ft0, ft1, ft2
+fmax.d ft0, ft1, ft2
+fcvt.w.s a0, ft0, rtz
+fcvt.wu.d a0, ft0
+fcvt.s.w ft0, a0
+fcvt.d.wu ft0, a0
+fcvt.s.d ft0, ft1
+fcvt.d.s ft0, ft1
+fmv.x.w a0, ft0
+fmv.w.x ft0, a0
+feq.s a0, ft0, ft1
+flt.d a0, ft0, ft1
+fle.s a0, ft0, ft1
+fclass.d a0, ft0
+csrrw a0, mstatus, a1
+csrrs a0, fcsr, zero
+csrrc zero, mie, a1
+csrrwi a0, 0x7c0, 5
+csrrsi a0, cycle, 31
+csrrci a0, frm, 1
+sh1add a0, a1, a2
+sh2add a0, a1, a2
+sh3add a0, a1, a2
+andn a0, a1, a2
+orn a0, a1, a2
+xnor a0, a1, a2
+clz a0, a1
+ctz a0, a1
+cpop a0, a1
+max a0, a1, a2
+maxu a0, a1, a2
+min a0, a1, a2
+minu a0, a1, a2
+sext.b a0, a1
+sext.h a0, a1
+rol a0, a1, a2
+ror a0, a1, a2
+rori a0, a1, 7
+orc.b a0, a1
+rev8 a0, a1
+c.fld fa0, 8(a1)
+c.fsd fa0, 8(a1)
+c.fldsp fa0, 16(sp)
+c.fsdsp fa0, 16(sp)
+c.flw fa0, 8(a1)
+c.fsw fa0, 8(a1)
+c.flwsp fa0, 16(sp)
+c.fswsp fa0, 16(sp)
+zext.h a0, a1
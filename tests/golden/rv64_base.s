@@ -0,0 +1,52 @@
+.option norelax
+.text
+.globl sum
+.type sum, @function
+sum:
+    li a2, 0
+    beqz a1, .Ldone
+.Lloop:
+    ld a3, 0(a0)
+    add a2, a2, a3
+    addi a0, a0, 8
+    addi a1, a1, -1
+    bnez a1, .Lloop
+.Ldone:
+    mv a0, a2
+    ret
+.size sum, .-sum
+
+.globl main
+.type main, @function
+main:
+    addi sp, sp, -32
+    sd ra, 24(sp)
+    sd s0, 16(sp)
+    lui a0, 0x12345
+    addiw a0, a0, 0x678
+    slli a1, a0, 33
+    srai a1, a1, 63
+    sraiw a2, a0, 3
+    subw a3, a0, a2
+    mulw a3, a3, a1
+    divuw a4, a3, a0
+    remw a5, a3, a0
+    lwu a6, -4(sp)
+    sltiu a7, a6, -1
+    jal ra, sum
+    auipc t0, 0xfffff
+    jalr t1, -16(t0)
+    bgeu a0, a1, .Lend
+    bltu a0, a1, .Lend
+    blt a0, a1, .Lend
+    bge a0, a1, .Lend
+    fence rw, rw
+    fence.i
+    ecall
+    ebreak
+.Lend:
+    ld ra, 24(sp)
+    ld s0, 16(sp)
+    addi sp, sp, 32
+    ret
+.size main, .-main
@@ -0,0 +1,27 @@
+.text
+.globl g
+g:
+lr.d a0, (a1)
+sc.d a0, a2, (a1)
+amoadd.d.aq a0, a2, (a1)
+amomaxu.d a0, a2, (a1)
+fcvt.l.s a0, ft0
+fcvt.lu.d a0, ft0, rtz
+fcvt.s.l ft0, a0
+fcvt.d.lu ft0, a0
+fmv.x.d a0, ft0
+fmv.d.x ft0, a0
+add.uw a0, a1, a2
+sh1add.uw a0, a1, a2
+sh2add.uw a0, a1, a2
+sh3add.uw a0, a1, a2
+slli.uw a0, a1, 40
+clzw a0, a1
+ctzw a0, a1
+cpopw a0, a1
+rolw a0, a1, a2
+rorw a0, a1, a2
+roriw a0, a1, 5
+rori a0, a1, 40
+zext.h a0, a1
+rev8 a0, a1
@@ -0,0 +1,11 @@
+# Прогон дизассемблера на входе из tests/golden и сравнение с эталонным листингом.
+# cmake -DDISASM=<lab_03> -DINPUT=<elf> -DEXPECTED=<txt> -DACTUAL=<txt> -P golden_test.cmake
+# --no-cache: тест не пишет в домашний каталог и проверяет декодер, а не кэш листингов.
+execute_process(COMMAND ${DISASM} --no-cache ${INPUT} ${ACTUAL} RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${DISASM} ${INPUT} exited with ${result}")
+endif ()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${EXPECTED} ${ACTUAL} RESULT_VARIABLE different)
+if (different)
+    message(FATAL_ERROR "${ACTUAL} differs from ${EXPECTED}")
+endif ()
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "elf_parser.h"
+#include "server_protocol.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using std::cout, std::cerr, std::endl;
+
+
+static const char* USAGE =
+        "Usage: disasm_client <socket> [--repeat N] disasm <elf> <start> <stop>\n"
+        "       disasm_client <socket> [--repeat N] symbol <elf> <name>\n"
+        "       disasm_client <socket> [--repeat N] at <elf> <address>\n"
+        "       disasm_client <socket> status";
+
+static uint64_t parse_number(const std::string& value) {
+    char* end = nullptr;
+    uint64_t number = std::strtoull(value.c_str(), &end, 0);
+    if (value.empty() || *end != '\0') throw DisassemblerException("Wrong address: " + value);
+    return number;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+//// Сервер открывает файлы из своего рабочего каталога, поэтому путь передаётся абсолютным.
+static std::string absolute_path(const std::string& filename) {
+    char buffer[PATH_MAX];
+    if (realpath(filename.c_str(), buffer) == nullptr) throw DisassemblerException("Unable to open elf file!");
+    return buffer;
+}
+
+static int connect_server(const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path))
+        throw DisassemblerException("Wrong socket path: " + socket_path);
+    address.sun_family = AF_UNIX;
+    socket_path.copy(address.sun_path, socket_path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        throw DisassemblerException("Unable to connect to server: " + socket_path);
+    }
+    return fd;
+}
+
+static Message_Writer build_request(const std::vector<std::string>& args) {
+    Message_Writer request;
+    const std::string& command = args[1];
+    if (command == "disasm" && args.size() == 5) {
+        request.put_u8((uint8_t) Request_Type::DISASSEMBLE);
+        request.put_string(absolute_path(args[2]));
+        request.put_u64(parse_number(args[3]));
+        request.put_u64(parse_number(args[4]));
+    }
+    else if (command == "symbol" && args.size() == 4) {
+        request.put_u8((uint8_t) Request_Type::SYMBOL);
+        request.put_string(absolute_path(args[2]));
+        request.put_string(args[3]);
+    }
+    else if (command == "at" && args.size() == 4) {
+        request.put_u8((uint8_t) Request_Type::INSTRUCTION);
+        request.put_string(absolute_path(args[2]));
+        request.put_u64(parse_number(args[3]));
+    }
+    else if (command == "status" && args.size() == 2) {
+        request.put_u8((uint8_t) Request_Type::STATUS);
+    }
+    else {
+        throw DisassemblerException(USAGE);
+    }
+    return request;
+}
+
+static void print_hex(uint64_t value) {
+    cout << "0x" << std::hex << value << std::dec;
+}
+
+static void print_response(Request_Type type, Message_Reader& response) {
+    switch (type) {
+        case Request_Type::DISASSEMBLE:
+            cout << response.get_string();
+            break;
+        case Request_Type::SYMBOL:
+            for (uint32_t count = response.get_u32(); count > 0; count--) {
+                uint64_t value = response.get_u64();
+                uint64_t size = response.get_u64();
+                unsigned info = response.get_u8();
+                print_hex(value);
+                cout << " size " << size << " type " << (info & 0xf) << " bind " << (info >> 4)
+                     << " " << response.get_string() << endl;
+            }
+            break;
+        case Request_Type::INSTRUCTION: {
+            uint64_t address = response.get_u64();
+            uint32_t raw = response.get_u32();
+            unsigned length = response.get_u8();
+            std::string_view function = response.get_string();
+            print_hex(address);
+            cout << " ";
+            print_hex(raw);
+            cout << " length " << length << " " << (function.empty() ? "-" : function) << endl;
+            cout << response.get_string() << endl;
+            break;
+        }
+        case Request_Type::STATUS: {
+            cout << "images " << response.get_u32() << endl;
+            cout << "memory " << response.get_u64() << endl;
+            cout << "limit " << response.get_u64() << endl;
+            cout << "hits " << response.get_u64() << endl;
+            cout << "misses " << response.get_u64() << endl;
+            cout << "evictions " << response.get_u64() << endl;
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        size_t repeat = 1;
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 < argc && arg == "--repeat") repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+            else args.push_back(arg);
+        }
+        if (args.size() < 2) throw DisassemblerException(USAGE);
+        Message_Writer request = build_request(args);
+        Request_Type type = (Request_Type) request.frame()[FRAME_HEADER_SIZE];
+
+        int fd = connect_server(args[0]);
+        std::string payload;
+        //// С --repeat в stderr печатается среднее время запроса вместе с передачей по сокету.
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < repeat; i++) {
+            if (!write_frame(fd, request.frame()) || !read_frame(fd, payload, MAX_RESPONSE_SIZE)) {
+                close(fd);
+                throw DisassemblerException("Unable to read server response!");
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        close(fd);
+        if (repeat > 1) cerr << repeat << " requests, " << seconds * 1e6 / repeat << " us per request" << endl;
+
+        Message_Reader response(payload);
+        if ((Response_Status) response.get_u8() != Response_Status::OK) {
+            cout << response.get_string() << endl;
+            return 1;
+        }
+        print_response(type, response);
+    }
+    catch (DisassemblerException& e) {
+        cout << e.get_message() << endl;
+        return 1;
+    }
+    catch (std::exception& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+#else
+int main() {
+    cout << "Server client needs Unix domain sockets!" << endl;
+    return 1;
+}
+#endif
@@ -0,0 +1,37 @@
+#include <iostream>
+#include <string>
+#include "elf_parser.h"
+#include "synthetic_elf.h"
+
+using std::cout, std::endl;
+
+
+int main(int argc, char** argv) {
+    try {
+        Synthetic_Elf_Params params;
+        std::string output;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 < argc && arg == "--size") params.text_size = parse_size(argv[++i]);
+            else if (i + 1 < argc && arg == "--mix") params.mix = parse_instruction_mix(argv[++i]);
+            else if (i + 1 < argc && arg == "--symbols-per-kb") params.symbols_per_kb = std::stod(argv[++i]);
+            else if (i + 1 < argc && arg == "--seed") params.seed = std::stoul(argv[++i]);
+            else if (i + 1 < argc && arg == "--class") params.elf_class = std::string(argv[++i]) == "64" ? ELFCLASS64 : ELFCLASS32;
+            else if (output.empty() && arg[0] != '-') output = arg;
+            else throw DisassemblerException("Unknown option: " + arg);
+        }
+        if (output.empty())
+            throw DisassemblerException("Usage: elf_gen [--size 100M] [--mix R=20,I=30,S=10,B=10,U=5,J=5,C=20] "
+                                        "[--symbols-per-kb 4] [--seed 1] [--class 32|64] <output.elf>");
+        write_synthetic_elf(output, params);
+    }
+    catch (DisassemblerException& e) {
+        cout << e.get_message() << endl;
+        return 1;
+    }
+    catch (std::exception& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
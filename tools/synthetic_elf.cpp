@@ -0,0 +1,219 @@
+#include "synthetic_elf.h"
+#include "decoder.h"
+#include "elf_parser.h"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+const uint32_t R_OPCODES[] = {0b0110011};
+const uint32_t I_OPCODES[] = {0b0010011, 0b0000011, 0b1100111};
+const uint32_t S_OPCODES[] = {0b0100011};
+const uint32_t B_OPCODES[] = {0b1100011};
+const uint32_t U_OPCODES[] = {0b0110111, 0b0010111};
+const uint32_t J_OPCODES[] = {0b1101111};
+
+template<size_t N>
+uint32_t random_instruction(std::mt19937& rng, const uint32_t (&opcodes)[N], Xlen xlen) {
+    while (true) {
+        uint32_t raw = (rng() & ~0x7fu) | opcodes[rng() % N];
+        if (decode_instruction(raw, 0, xlen).mnemonic != Mnemonic::UNKNOWN) return raw;
+    }
+}
+
+uint16_t random_compressed(std::mt19937& rng, Xlen xlen) {
+    while (true) {
+        uint16_t raw = rng();
+        if ((raw & 0b11) == 0b11) continue;
+        if (decode_compressed(raw, 0, xlen).mnemonic != Mnemonic::UNKNOWN) return raw;
+    }
+}
+
+void put(std::vector<char>& out, const void* data, size_t size) {
+    out.insert(out.end(), (const char*) data, (const char*) data + size);
+}
+
+template<typename Elf>
+typename Elf::Section_Header section_header(uint32_t name, uint32_t type, uint64_t flags, uint64_t offset,
+                                            uint64_t size, uint32_t link, uint32_t info, uint64_t align,
+                                            uint64_t entsize) {
+    typename Elf::Section_Header section{};
+    section.sh_name = name;
+    section.sh_type = type;
+    section.sh_flags = flags;
+    section.sh_offset = offset;
+    section.sh_size = size;
+    section.sh_link = link;
+    section.sh_info = info;
+    section.sh_addralign = align;
+    section.sh_entsize = entsize;
+    return section;
+}
+
+template<typename Elf>
+void write_elf(std::ofstream& output, const Synthetic_Elf_Params& params) {
+    using Header = typename Elf::Header;
+    using Symbol = typename Elf::Symbol;
+    const Xlen xlen = Elf::XLEN;
+    std::mt19937 rng(params.seed);
+    const Instruction_Mix& m = params.mix;
+    std::discrete_distribution<int> kind({m.r, m.i, m.s, m.b, m.u, m.j, m.c});
+    std::uniform_real_distribution<double> unit(0, 1);
+    double symbol_probability = params.symbols_per_kb / 1024 * 3;
+
+    std::vector<char> symtab;
+    std::string strtab(1, '\0');
+    Symbol null_symbol{};
+    put(symtab, &null_symbol, sizeof(null_symbol));
+
+    Header header{};
+    output.write((const char*) &header, sizeof(header));
+
+    //// .text пишется блоками по мере генерации.
+    std::vector<char> block;
+    uint64_t size = 0;
+    uint64_t text_size = params.text_size & ~1ull;
+    uint64_t last_function = 0;
+    size_t last_function_symbol = 0;
+    //// Размер функции - до начала следующей, известен только когда она встретится.
+    auto close_function = [&symtab, &last_function_symbol, &last_function](uint64_t end) {
+        if (last_function_symbol == 0) return;
+        decltype(Symbol::st_size) function_size = end - last_function;
+        std::memcpy(symtab.data() + last_function_symbol + offsetof(Symbol, st_size),
+                    &function_size, sizeof(function_size));
+    };
+    while (size < text_size) {
+        if (symbol_probability > 0 && unit(rng) < symbol_probability) {
+            bool function = size == 0 || size - last_function > 256;
+            std::string name = (function ? "f_" : ".L") + std::to_string(size);
+            Symbol symbol{};
+            symbol.st_name = strtab.size();
+            symbol.st_value = size;
+            symbol.st_info = function ? 0x12 : 0x00;
+            symbol.st_shndx = 1;
+            if (function) {
+                close_function(size);
+                last_function = size;
+                last_function_symbol = symtab.size();
+            }
+            strtab.append(name).push_back('\0');
+            put(symtab, &symbol, sizeof(symbol));
+        }
+        int k = text_size - size < 4 ? 6 : kind(rng);
+        if (k == 6) {
+            uint16_t raw = random_compressed(rng, xlen);
+            put(block, &raw, sizeof(raw));
+            size += 2;
+        }
+        else {
+            const uint32_t raw = k == 0 ? random_instruction(rng, R_OPCODES, xlen) :
+                    k == 1 ? random_instruction(rng, I_OPCODES, xlen) :
+                    k == 2 ? random_instruction(rng, S_OPCODES, xlen) :
+                    k == 3 ? random_instruction(rng, B_OPCODES, xlen) :
+                    k == 4 ? random_instruction(rng, U_OPCODES, xlen) :
+                    random_instruction(rng, J_OPCODES, xlen);
+            put(block, &raw, sizeof(raw));
+            size += 4;
+        }
+        if (block.size() >= (1 << 20)) {
+            output.write(block.data(), block.size());
+            block.clear();
+        }
+    }
+    output.write(block.data(), block.size());
+    close_function(size);
+
+    const std::string shstrtab("\0.text\0.symtab\0.strtab\0.shstrtab\0", 34);
+    //// Таблицы выравниваются по размеру слова класса.
+    const uint64_t align = sizeof(header.e_shoff);
+    uint64_t text_offset = sizeof(header);
+    uint64_t symtab_offset = text_offset + size;
+    symtab_offset = (symtab_offset + align - 1) & ~(align - 1);
+    output.write("\0\0\0\0\0\0\0", symtab_offset - text_offset - size);
+    output.write(symtab.data(), symtab.size());
+    uint64_t strtab_offset = symtab_offset + symtab.size();
+    output.write(strtab.data(), strtab.size());
+    uint64_t shstrtab_offset = strtab_offset + strtab.size();
+    output.write(shstrtab.data(), shstrtab.size());
+    uint64_t shoff = shstrtab_offset + shstrtab.size();
+    uint64_t padding = ((shoff + align - 1) & ~(align - 1)) - shoff;
+    output.write("\0\0\0\0\0\0\0", padding);
+    shoff += padding;
+
+    typename Elf::Section_Header sections[5] = {
+            {},
+            section_header<Elf>(1, 1, 6, text_offset, size, 0, 0, 4, 0),
+            section_header<Elf>(7, 2, 0, symtab_offset, symtab.size(), 3, 1, align, sizeof(Symbol)),
+            section_header<Elf>(15, 3, 0, strtab_offset, strtab.size(), 0, 0, 1, 0),
+            section_header<Elf>(23, 3, 0, shstrtab_offset, shstrtab.size(), 0, 0, 1, 0),
+    };
+    output.write((const char*) sections, sizeof(sections));
+
+    const unsigned char ident[16] = {0x7f, 'E', 'L', 'F', (unsigned char) Elf::CLASS, 1, 1};
+    std::copy(ident, ident + 16, header.e_ident);
+    header.e_type = 1;
+    header.e_machine = 0xf3;
+    header.e_version = 1;
+    header.e_shoff = shoff;
+    header.e_ehsize = sizeof(header);
+    header.e_shentsize = sizeof(typename Elf::Section_Header);
+    header.e_shnum = 5;
+    header.e_shstrndx = 4;
+    output.seekp(0);
+    output.write((const char*) &header, sizeof(header));
+}
+
+}
+
+
+void write_synthetic_elf(const std::string& filename, const Synthetic_Elf_Params& params) {
+    std::ofstream output(filename, std::ios::binary);
+    if (!output)
+        throw DisassemblerException("Unable to open file for saving result!");
+    if (params.elf_class == ELFCLASS64) write_elf<Elf64>(output, params);
+    else write_elf<Elf32>(output, params);
+    if (!output)
+        throw DisassemblerException("Unable to write result!");
+}
+
+Instruction_Mix parse_instruction_mix(const std::string& spec) {
+    Instruction_Mix mix{0, 0, 0, 0, 0, 0, 0};
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        size_t eq = item.find('=');
+        if (eq != 1)
+            throw DisassemblerException("Wrong instruction mix: " + spec);
+        double weight = std::stod(item.substr(2));
+        switch (item[0]) {
+            case 'R': case 'r': mix.r = weight; break;
+            case 'I': case 'i': mix.i = weight; break;
+            case 'S': case 's': mix.s = weight; break;
+            case 'B': case 'b': mix.b = weight; break;
+            case 'U': case 'u': mix.u = weight; break;
+            case 'J': case 'j': mix.j = weight; break;
+            case 'C': case 'c': mix.c = weight; break;
+            default: throw DisassemblerException("Wrong instruction mix: " + spec);
+        }
+        pos = end + 1;
+    }
+    return mix;
+}
+
+uint64_t parse_size(const std::string& spec) {
+    size_t end = 0;
+    uint64_t value = std::stoull(spec, &end);
+    std::string suffix = spec.substr(end);
+    if (suffix == "K" || suffix == "k") return value << 10;
+    if (suffix == "M" || suffix == "m") return value << 20;
+    if (suffix == "G" || suffix == "g") return value << 30;
+    if (!suffix.empty())
+        throw DisassemblerException("Wrong size: " + spec);
+    return value;
+}
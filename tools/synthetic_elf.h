@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+
+//// Веса классов команд в генерируемом .text.
+struct Instruction_Mix {
+    double r = 20;
+    double i = 30;
+    double s = 10;
+    double b = 10;
+    double u = 5;
+    double j = 5;
+    double c = 20;
+};
+
+struct Synthetic_Elf_Params {
+    uint64_t text_size = 1 << 20;
+    Instruction_Mix mix;
+    //// Сколько символов приходится на килобайт .text.
+    double symbols_per_kb = 4;
+    uint32_t seed = 1;
+    //// ELFCLASS32 (RV32) или ELFCLASS64 (RV64).
+    char elf_class = 1;
+};
+
+//// Пишет RV32/RV64 ELF (.text, .symtab, .strtab, .shstrtab) потоково, не держа .text в памяти.
+void write_synthetic_elf(const std::string& filename, const Synthetic_Elf_Params& params);
+
+Instruction_Mix parse_instruction_mix(const std::string& spec);
+
+uint64_t parse_size(const std::string& spec);